@@ -4,11 +4,15 @@
 #include "src/hexBoardHardware.h" // API to work with hexBoard hardware
 #include "src/hexBoardLayout.h" // API to work with hexBoard hardware
 #include "src/midiHandler.h"
+#include "src/hexBoardSynth.h"
 
-void read_key(button_t& b) {
-  b.key_state    = pinGrid.read_keypress(b.atMux, b.atCol);
-  b.key_velocity = pinGrid.read_velocity(b.atMux, b.atCol);
-  b.key_pressure = pinGrid.read_pressure(b.atMux, b.atCol);
+void read_key(button_t& b, const key_event_t& e) {
+  b.key_state    = e.edge;
+  b.key_velocity = e.velocity;
+  b.key_pressure = pinGrid.pressure_of(e.key, e.level);
+  if (e.edge == button_press) {
+    b.timePressed = e.time_uS;
+  }
 }
 
 void debug_key(button_t& b) {
@@ -26,13 +30,15 @@ void process_note(music_key_t& n) {
   switch (n.key_state) {
     case button_press:
       //tryMIDInoteOn(h);
-      //trySynthNoteOn(h);
+      synth_note_on(n);
       break;
     case button_release:
       //tryMIDInoteOff(h);
-      //trySynthNoteOff(h);
+      synth_note_off(n);
       break; 
   }
+  // the edge has been handled; the key stays down or up until the next event
+  n.key_state = (n.key_state == button_press ? button_hold : button_off);
 }
 
 void process_command(other_cmd_t& c) {
@@ -49,32 +55,188 @@ void process_command(other_cmd_t& c) {
     default: // inactive
       break;
   }
+  c.key_state = (c.key_state == button_press ? button_hold : button_off);
 }
 
+// the scanner queues an event whenever a key goes down or comes up,
+// so only the keys that changed are looked at here
 void process_all_keys() {
-  // only do this if the pingrid object is free
-  if (!(pinGrid.is_background_process_complete())) return;
-  // read in the new pin state completely first
-  for (auto& h : hexBoard.keys)     read_key(h);
-  for (auto& h : hexBoard.commands) read_key(h);
-  // then release pingrid object
-  pinGrid.resume_background_process();
-  // if you are in play mode
-  for (auto& h : hexBoard.keys) {
-    debug_key(h); // if needed
-    process_note(h);
+  key_event_t e;
+  while (pinGrid.read_event(e)) {
+    auto p = hexBoard.switch_to_pixel.find(
+      button_grid_t::switch_id(pinGrid.mux_of(e.key), pinGrid.col_of(e.key)));
+    if (p == hexBoard.switch_to_pixel.end()) {
+      continue; // hardwired or unused
+    }
+    unsigned i = hexBoard.pixel_to_index.at(p->second);
+    // if you are in play mode
+    if (hexBoard.pixel_is_cmd.at(p->second)) {
+      read_key(hexBoard.commands[i], e);
+      debug_key(hexBoard.commands[i]); // if needed
+      process_command(hexBoard.commands[i]);
+    } else {
+      read_key(hexBoard.keys[i], e);
+      debug_key(hexBoard.keys[i]); // if needed
+      process_note(hexBoard.keys[i]);
+    }
+    // otherwise make the keys do something else
+  }
+}
+
+// turns and clicks of the rotary knob, oldest first.
+// nothing uses them yet, so they are only logged
+void process_rotary() {
+  rotary_event_t e;
+  while (rotary.read_event(e)) {
+    switch (e.type) {
+      case rotary_turn:
+        sendToLog("rotary turn " + std::to_string(e.step) + " by " + std::to_string(e.amount));
+        break;
+      case rotary_click:
+        sendToLog("rotary click " + std::to_string(e.amount) + " mS");
+        break;
+      case rotary_double_click:
+        sendToLog("rotary double click");
+        break;
+      case rotary_long_press:
+        sendToLog("rotary long press");
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// out-of-scale keys go dark instead of dim. nothing sets it yet
+bool scaleLock = false;
+
+// which of its stored colors a button shows, as in the V1 firmware.
+// these are the pixel's inputs: it is only composed again when they change
+enum {
+  LED_show_anim = 0,
+  LED_show_play = 1,
+  LED_show_rest = 2,
+  LED_show_off = 3,
+  LED_show_dim = 4,
+};
+unsigned LED_state_of(const music_key_t& k) {
+       if (k.animate)                 { return LED_show_anim; }
+  else if (k.key_state != button_off) { return LED_show_play; }
+  else if (k.inScale)                 { return LED_show_rest; }
+  else if (scaleLock)                 { return LED_show_off;  }
+  else                                { return LED_show_dim;  }
+}
+pixel_level LED_code_of(const button_t& b, unsigned state) {
+  switch (state) {
+    case LED_show_anim: return b.LEDcodeAnim;
+    case LED_show_play: return b.LEDcodePlay;
+    case LED_show_off:  return b.LEDcodeOff;
+    case LED_show_dim:  return b.LEDcodeDim;
+    default:            return b.LEDcodeRest;
+  }
+}
+
+// the colors are the ones the layout stored in each button (all off
+// until it sets them; call LEDs.invalidate() when it does)
+void LED_update_pixels() {
+  for (auto& k : hexBoard.keys) {
+    unsigned state = LED_state_of(k);
+    if (LEDs.changed(k.pixel, state)) {
+      LEDs.set(k.pixel, LED_code_of(k, state));
+    }
+  }
+  for (auto& c : hexBoard.commands) {
+    unsigned state = (c.key_state != button_off ? LED_show_play : LED_show_rest);
+    if (LEDs.changed(c.pixel, state)) {
+      LEDs.set(c.pixel, LED_code_of(c, state));
+    }
   }
-  for (auto& h : hexBoard.commands) {
-    debug_key(h); // if needed
-    process_command(h);
+  LEDs.show();    // if anything changed, packs the frame and starts sending it; does not wait
+}
+
+// single-character commands typed into the serial monitor
+//   t  dump the hardware task manager statistics
+//   r  reset them
+//   k  debounce statistics for every key that has changed
+//   s  sample rate of every key read more often than the sweep
+//   c  calibration of every analog key
+//   w  save the analog key calibration to flash now
+void process_serial_commands() {
+  while (Serial.available()) {
+    switch (Serial.read()) {
+      case 't':
+        for (unsigned i = 0; i < task_mgr.task_list.size(); ++i) {
+          sendToLog(task_mgr.report(i));
+        }
+        sendToLog("interrupts over budget " + std::to_string(task_mgr.get_deferred()));
+        sendToLog("key frames " + std::to_string(pinGrid.get_frame_count())
+          + " dropped " + std::to_string(pinGrid.get_dropped_frames())
+          + " scan rate " + std::to_string(pinGrid.get_scan_rate_in_Hz()) + " Hz"
+          + " events lost " + std::to_string(pinGrid.get_lost_events()));
+        sendToLog("LED frames " + std::to_string(LEDs.get_frames())
+          + " sent " + std::to_string(strip.get_frames_sent())
+          + " replaced " + std::to_string(strip.get_frames_replaced())
+          + " pixels composed " + std::to_string(LEDs.get_pixels_composed())
+          + " frame time " + std::to_string(LEDs.get_mean_frame_time_in_uS())
+          + " uS mean, " + std::to_string(LEDs.get_max_frame_time_in_uS()) + " uS max"
+          + " current " + std::to_string(LEDs.get_current_in_mA()) + " mA"
+          + " power scale " + std::to_string(LEDs.get_power_scale()) + "/256");
+        sendToLog("rotary missed steps " + std::to_string(rotary.get_missed_steps())
+          + " events lost " + std::to_string(rotary.get_lost_events()));
+        break;
+      case 'r':
+        task_mgr.reset_stats();
+        break;
+      case 'k':
+        for (unsigned i = 0; i < pinGrid.buttonCount(); ++i) {
+          if (pinGrid.get_raw_changes(i)) {
+            sendToLog(pinGrid.debounce_report(i));
+          }
+        }
+        break;
+      case 's': {
+        pinGrid.take_snapshot();
+        unsigned sweep = pinGrid.get_scan_rate_in_Hz();
+        sendToLog("sweep " + std::to_string(sweep) + " Hz, at most "
+          + std::to_string(pinGrid.get_sweep_deadline_in_polls()) + " polls"
+          + ", hot keys " + std::to_string(pinGrid.get_hot_key_count()));
+        for (unsigned c = 0; c < pinGrid.colPinCount(); ++c) {
+          for (unsigned m = 0; m < pinGrid.muxPinMaxValue(); ++m) {
+            unsigned hz = pinGrid.get_sample_rate_in_Hz(m, c);
+            if (hz > sweep + sweep / 2) {
+              sendToLog("  " + std::to_string(c) + "C " + std::to_string(m) + "M "
+                + std::to_string(hz) + " Hz");
+            }
+          }
+        }
+        break;
+      }
+      case 'c':
+        pinGrid.take_snapshot();
+        for (unsigned i = 0; i < pinGrid.buttonCount(); ++i) {
+          if (pinGrid.is_analog(i)) {
+            sendToLog(pinGrid.calibration_report(i));
+          }
+        }
+        break;
+      case 'w':
+        sendToLog(keyCalibrationFile.save() ? "calibration saved" : "calibration not saved");
+        break;
+      default:
+        break;
+    }
   }
-  // otherwise make the keys do something else
 }
 
 //  a global variable used to control the timing of setup functions between cores
 int setup_phase = 0;
+//  loop() paces itself with these: inputs every 2 seconds (for now), LED frames
+//  at the target frame rate. in between it sleeps until the sooner one is due
+softTimer input_timer;
+softTimer LED_frame_timer;
 
 void setup() {
+  input_timer.start(2'000'000, 0);  //  from power on, so the first pass of loop() handles inputs
   delay(2000);
   //#if (defined(ARDUINO_ARCH_MBED) && defined(ARDUINO_ARCH_RP2040))
   //  Manual begin() is required on core without built-in support for TinyUSB 
@@ -86,8 +248,9 @@ void setup() {
   //OLED_setup();               //  Start the OLED screen, in case you want a splash screen?
   //presets_littleFS_setup();   //  Set up the littleFS file system first (to pull stored user settings in v2) 
   hardware_setup();           //  set up the keyboard, rotary, and audio functions based on config constants.
+  synth_setup(default_12_edo); //  make sure the synth is reset so no notes are running
     setup_phase = 1;        //  change the setup flag to let the other core know to start the background processes
-  //synth_reset();              //  make sure the synth is reset so no notes are running
+  LED_frame_timer.start(LED_frame_period_in_uS, 0);
   //MIDI_setup();               //  Set up the USB (Serial, pin 0) and MIDI-out (Serial1, pin 1) as MIDI objects
   //gridSystem_setup();         //  Set up the hex grid object, and set the pins that will read the button states 
   //applyLayout(); // see V1.assignment.h. Based on the default layout, populate grid with notes and colors
@@ -100,16 +263,24 @@ void setup() {
 }
 
 
-void loop() { // need to add soft loop timing.
+void loop() {
   //timing_measure_lap();           //  get time in uS at the start of the loop, measure loop duration
   //OLED_screenSaver();           //  every 1 second. reduces wear-and-tear on OLED panel  
-  process_all_keys();             //  every loop. interpret button press actions, play MIDI / synth notes
+  if (input_timer.ifDone_thenRepeat()) {
+    process_all_keys();             //  interpret button press actions, play MIDI / synth notes
+    process_rotary();               //  the knob's turns and clicks
+    process_serial_commands();      //  diagnostic commands from the serial monitor
+    keyCalibrationFile.autosave();  //  now and then. keep the analog key calibration in flash
+  }
   //interface_update_wheels();    //  v1.0 firmware only. deal with the pitch/mod wheel
   //synth_arpeggiate();           //  every X millis based on user input. arpeggiate if synth mode allows it
   //animate_calculate_pixels();   //  every 17 or 33 millis, calculate the next frame of responsive animations
-  //LED_update_pixels();          //  every 17 or 33 millis, send updated pixel data to LEDs
+  if (LED_frame_timer.ifDone_thenRepeat()) {
+    LED_update_pixels();          //  every frame, send updated pixel data to LEDs
+  }
+  strip.update();                 //  every loop. start a frame that had to wait for the strip
   //interface_interpret_rotary(); //  every loop. interpret rotary knob presses, send to menu object, refresh OLED
-  delay(2000);
+  delayMicroseconds(std::min(input_timer.getRemaining(), LED_frame_timer.getRemaining()));
   //sendToLog(txt(lapTime - 2000000));
 }
 
@@ -119,9 +290,6 @@ void setup1() {
 }
 void loop1() {
   //  dedicate this core to computing the synth audio and running the background processes.
-  if (audioOut.roomToWrite()) {
-    //uint8_t temp = ((getTheCurrentTime() >> 12) & 0b00010000);
-    //audioOut.write(temp /* synth.next_sample() */ );   //  write synth samples tnto the audio buffer.
-  }
+  synth_fill_audio_buffer();    //  write synth samples into the audio buffer, a block at a time.
   //  and respond to all hardware task manager interrupts when they are called.
 }
@@ -0,0 +1,18 @@
+#pragma once
+// host stand-in for the TinyUSB MIDI device
+#include "Arduino.h"
+
+class Adafruit_USBD_MIDI {
+  public:
+    bool begin() {
+      return true;
+    }
+};
+
+class sim_usb_device_obj {
+  public:
+    bool mounted() {
+      return true;
+    }
+};
+inline sim_usb_device_obj TinyUSBDevice;
@@ -0,0 +1,98 @@
+#pragma once
+// host stand-in for the arduino-pico core.
+// only what the HexBoard firmware calls is provided.
+#include <stdint.h>
+#include <math.h>
+#include <string>
+#include "hexBoardSim.h"
+
+using byte = uint8_t;
+
+enum {
+  LOW = 0,
+  HIGH = 1,
+};
+enum {
+  INPUT = 0,
+  OUTPUT = 1,
+  INPUT_PULLUP = 2,
+  INPUT_PULLDOWN = 3,
+};
+enum {
+  CHANGE = 2,
+  FALLING = 3,
+  RISING = 4,
+};
+
+inline void pinMode(unsigned pin, unsigned mode) {
+  (void)pin;
+  (void)mode;
+}
+inline void digitalWrite(unsigned pin, int level) {
+  sim_board.write_pin(pin, level);
+}
+inline int digitalRead(unsigned pin) {
+  return sim_board.read_pin(pin);
+}
+// pin interrupts: only CHANGE is modeled
+inline unsigned digitalPinToInterrupt(unsigned pin) {
+  return pin;
+}
+inline void attachInterrupt(unsigned pin, void (*f)(), unsigned mode) {
+  (void)mode;
+  sim_board.attach_pin_irq(pin, f);
+}
+inline void detachInterrupt(unsigned pin) {
+  sim_board.detach_pin_irq(pin);
+}
+inline int analogRead(unsigned pin) {
+  return sim_board.read_pin(pin);
+}
+inline void delayMicroseconds(unsigned uS) {
+  sim_board.advance(uS);
+}
+inline void delay(unsigned long mS) {
+  sim_board.advance(1000ull * mS);
+}
+inline unsigned long micros() {
+  return (unsigned long)sim_board.now();
+}
+inline unsigned long millis() {
+  return (unsigned long)(sim_board.now() / 1000);
+}
+
+class sim_serial_obj {
+  private:
+    const char* _name;
+  public:
+    sim_serial_obj(const char* name) : _name(name) {}
+    void begin(unsigned long baud) {
+      (void)baud;
+    }
+    int available() {
+      return (int)sim_board.serial_input.size();
+    }
+    int read() {
+      if (sim_board.serial_input.empty()) {
+        return -1;
+      }
+      int c = (unsigned char)sim_board.serial_input[0];
+      sim_board.serial_input.erase(0, 1);
+      return c;
+    }
+    void print(const char* msg) {
+      sim_board.print(_name, msg);
+    }
+    void println(const char* msg) {
+      sim_board.print(_name, msg);
+    }
+    void println(const std::string& msg) {
+      sim_board.print(_name, msg);
+    }
+    operator bool() const {
+      return true;
+    }
+};
+using HardwareSerial = sim_serial_obj;
+inline sim_serial_obj Serial("LOG");
+inline sim_serial_obj Serial1("SER1");
@@ -0,0 +1,158 @@
+#pragma once
+// host stand-in for the arduino-pico LittleFS.
+// files live in memory for the run, or in a host folder when the sim
+// is started with -f, so that they are still there the next run.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+class LittleFSConfig {
+  public:
+    void setAutoFormat(bool on) {
+      (void)on;
+    }
+};
+
+class sim_littlefs_obj;
+
+class File {
+  private:
+    sim_littlefs_obj* _fs = nullptr;
+    std::string _path;
+    std::string _data;
+    size_t _pos = 0;
+    bool _writing = false;
+  public:
+    File() {}
+    File(sim_littlefs_obj* fs, const std::string& path, const std::string& data, bool writing)
+      : _fs(fs), _path(path), _data(data), _writing(writing) {}
+    ~File() {
+      close();
+    }
+    File(File&& f) {
+      *this = std::move(f);
+    }
+    File& operator=(File&& f) {
+      close();
+      _fs = f._fs;
+      _path = f._path;
+      _data = f._data;
+      _pos = f._pos;
+      _writing = f._writing;
+      f._fs = nullptr;
+      return *this;
+    }
+    explicit operator bool() const {
+      return _fs != nullptr;
+    }
+    size_t size() const {
+      return _data.size();
+    }
+    size_t write(const uint8_t* buf, size_t n) {
+      if (!_fs || !_writing) {
+        return 0;
+      }
+      _data.append((const char*)buf, n);
+      return n;
+    }
+    size_t read(uint8_t* buf, size_t n) {
+      if (!_fs || _pos >= _data.size()) {
+        return 0;
+      }
+      if (n > _data.size() - _pos) {
+        n = _data.size() - _pos;
+      }
+      memcpy(buf, _data.data() + _pos, n);
+      _pos += n;
+      return n;
+    }
+    inline void close();
+};
+
+class sim_littlefs_obj {
+  private:
+    std::map<std::string, std::string> _files;
+    std::string host_path(const std::string& path) {
+      std::string p = path;
+      for (auto& c : p) {
+        if (c == '/') {
+          c = '_';
+        }
+      }
+      return host_dir + "/" + p;
+    }
+  public:
+    std::string host_dir;   // empty = memory only
+    uint64_t writes = 0;    // files written
+    bool full = false;      // true: opening a file to write fails, as on a full flash
+    uint64_t refused = 0;   // files not written because of that
+    void setConfig(const LittleFSConfig& cfg) {
+      (void)cfg;
+    }
+    bool begin() {
+      return true;
+    }
+    bool exists(const char* path) {
+      if (_files.count(path)) {
+        return true;
+      }
+      if (host_dir.empty()) {
+        return false;
+      }
+      FILE* f = fopen(host_path(path).c_str(), "rb");
+      if (f) {
+        fclose(f);
+      }
+      return f != nullptr;
+    }
+    File open(const char* path, const char* mode) {
+      if (mode[0] == 'w') {
+        if (full) {
+          ++refused;
+          return File();
+        }
+        return File(this, path, "", true);
+      }
+      auto p = _files.find(path);
+      if (p != _files.end()) {
+        return File(this, path, p->second, false);
+      }
+      if (!host_dir.empty()) {
+        FILE* f = fopen(host_path(path).c_str(), "rb");
+        if (f) {
+          std::string data;
+          char buf[256];
+          size_t n;
+          while ((n = fread(buf, 1, sizeof(buf), f))) {
+            data.append(buf, n);
+          }
+          fclose(f);
+          _files[path] = data;
+          return File(this, path, data, false);
+        }
+      }
+      return File();
+    }
+    void store(const std::string& path, const std::string& data) {
+      _files[path] = data;
+      ++writes;
+      if (!host_dir.empty()) {
+        FILE* f = fopen(host_path(path).c_str(), "wb");
+        if (f) {
+          fwrite(data.data(), 1, data.size(), f);
+          fclose(f);
+        }
+      }
+    }
+};
+
+inline sim_littlefs_obj LittleFS;
+
+inline void File::close() {
+  if (_fs && _writing) {
+    _fs->store(_path, _data);
+  }
+  _fs = nullptr;
+}
@@ -0,0 +1,45 @@
+#pragma once
+// host stand-in for the FortySevenEffects MIDI library.
+// every message sent is printed with the virtual time stamp.
+#include <string>
+#include "Arduino.h"
+
+class sim_midi_port_obj {
+  private:
+    std::string _name;
+    void send(const std::string& msg) {
+      ++sim_board.midi_messages;
+      sim_board.print("MIDI", _name + " " + msg);
+    }
+  public:
+    sim_midi_port_obj(const char* name) : _name(name) {}
+    void begin(int ch = 0) {
+      (void)ch;
+    }
+    void sendNoteOn(int note, int vel, int ch) {
+      send("noteOn " + std::to_string(note) + " " + std::to_string(vel) + " ch" + std::to_string(ch));
+    }
+    void sendNoteOff(int note, int vel, int ch) {
+      send("noteOff " + std::to_string(note) + " " + std::to_string(vel) + " ch" + std::to_string(ch));
+    }
+    void sendPitchBend(int bend, int ch) {
+      send("pitchBend " + std::to_string(bend) + " ch" + std::to_string(ch));
+    }
+    void sendAfterTouch(int note, int pressure, int ch) {
+      send("polyPressure " + std::to_string(note) + " " + std::to_string(pressure) + " ch" + std::to_string(ch));
+    }
+    void sendControlChange(int cc, int value, int ch) {
+      send("CC " + std::to_string(cc) + " " + std::to_string(value) + " ch" + std::to_string(ch));
+    }
+    void beginRpn(int rpn, int ch) {
+      send("beginRpn " + std::to_string(rpn) + " ch" + std::to_string(ch));
+    }
+    void sendRpnValue(int value, int ch) {
+      send("rpnValue " + std::to_string(value) + " ch" + std::to_string(ch));
+    }
+    void endRpn(int ch) {
+      send("endRpn ch" + std::to_string(ch));
+    }
+};
+
+#define MIDI_CREATE_INSTANCE(Type, SerialPort, Name) sim_midi_port_obj Name(#Name);
@@ -0,0 +1,3 @@
+#pragma once
+// host stand-in; the firmware includes <Wire.h> to pull in the core
+#include "Arduino.h"
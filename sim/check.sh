@@ -0,0 +1,46 @@
+#!/bin/sh
+# Builds the simulator and the host tests, then runs every check:
+#   - each sim/traces/*.trace with -e against the .expected log next
+#     to it (and the options on its "# options:" line, if any)
+#   - each sim/tests/*.cpp, which exits nonzero if its test fails
+# Run from the top of the repository:
+#   sh sim/check.sh [build_dir]
+# Exits nonzero if anything failed.
+
+build=${1:-/tmp/hexboard_check}
+mkdir -p "$build" || exit 1
+cxx=${CXX:-g++}
+failed=0
+
+echo "building the simulator"
+$cxx -std=gnu++17 -O2 -I sim -o "$build/hexboard_sim" sim/hexBoardSim.cpp || exit 1
+
+for trace in sim/traces/*.trace; do
+  name=$(basename "$trace" .trace)
+  options=$(sed -n 's/^# options:\([^(]*\).*/\1/p' "$trace")
+  if "$build/hexboard_sim" -t "$trace" $options -q \
+       -e "sim/traces/$name.expected" > "$build/$name.out"; then
+    echo "ok    trace $name"
+  else
+    echo "FAIL  trace $name"
+    grep -A2 "^check failed" "$build/$name.out"
+    failed=1
+  fi
+done
+
+for test in sim/tests/*.cpp; do
+  [ -e "$test" ] || continue
+  name=$(basename "$test" .cpp)
+  if ! $cxx -std=gnu++17 -O2 -pthread -I sim -o "$build/$name" "$test"; then
+    echo "FAIL  test $name (does not build)"
+    failed=1
+  elif "$build/$name" > "$build/$name.out"; then
+    echo "ok    test $name"
+  else
+    echo "FAIL  test $name"
+    cat "$build/$name.out"
+    failed=1
+  fi
+done
+
+exit $failed
@@ -0,0 +1,13 @@
+#pragma once
+// host stand-in for the pico-sdk clocks. the system clock is the
+// arduino-pico default.
+#include <stdint.h>
+
+enum clock_index {
+  clk_sys = 5,
+};
+
+inline uint32_t clock_get_hz(clock_index clk) {
+  (void)clk;
+  return 133'000'000;
+}
@@ -0,0 +1,58 @@
+#pragma once
+// host stand-in for the pico-sdk DMA block.
+// a channel paced by a PIO DREQ is busy for as long as the state
+// machine takes to shift out every word; the sim board keeps the
+// transfer, checks it, and counts it as an LED frame.
+#include <stdint.h>
+#include "../hexBoardSim.h"
+
+enum dma_channel_transfer_size {
+  DMA_SIZE_8 = 0,
+  DMA_SIZE_16 = 1,
+  DMA_SIZE_32 = 2,
+};
+
+struct dma_channel_config {
+  unsigned dreq = 0;
+};
+
+inline int dma_claim_unused_channel(bool required) {
+  (void)required;
+  return sim_board.dma_claimed++;
+}
+inline dma_channel_config dma_channel_get_default_config(unsigned channel) {
+  (void)channel;
+  return dma_channel_config();
+}
+inline void channel_config_set_transfer_data_size(dma_channel_config* c, dma_channel_transfer_size size) {
+  (void)c;
+  (void)size;
+}
+inline void channel_config_set_read_increment(dma_channel_config* c, bool incr) {
+  (void)c;
+  (void)incr;
+}
+inline void channel_config_set_write_increment(dma_channel_config* c, bool incr) {
+  (void)c;
+  (void)incr;
+}
+inline void channel_config_set_dreq(dma_channel_config* c, unsigned dreq) {
+  c->dreq = dreq;
+}
+inline void dma_channel_configure(unsigned channel, const dma_channel_config* c, volatile void* write_addr,
+    const volatile void* read_addr, unsigned count, bool trigger) {
+  (void)channel;
+  (void)write_addr;
+  (void)read_addr;
+  (void)count;
+  (void)trigger;
+  sim_board.dma_dreq = c->dreq;
+}
+inline void dma_channel_transfer_from_buffer_now(unsigned channel, const volatile void* read_addr, unsigned count) {
+  (void)channel;
+  sim_board.start_led_transfer((const uint32_t*)read_addr, count);
+}
+inline bool dma_channel_is_busy(unsigned channel) {
+  (void)channel;
+  return sim_board.led_transfer_busy();
+}
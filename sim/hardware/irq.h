@@ -0,0 +1,13 @@
+#pragma once
+// host stand-in for the pico-sdk NVIC helpers.
+// alarm N raises IRQ N, as TIMER_IRQ_0..3 do on the RP2040.
+#include "../hexBoardSim.h"
+
+typedef void (*irq_handler_t)(void);
+
+inline void irq_set_exclusive_handler(unsigned num, irq_handler_t handler) {
+  sim_board.irq_handler[num] = handler;
+}
+inline void irq_set_enabled(unsigned num, bool enabled) {
+  sim_board.irq_enabled[num] = enabled;
+}
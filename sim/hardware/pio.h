@@ -0,0 +1,96 @@
+#pragma once
+// host stand-in for the pico-sdk PIO block.
+// nothing is executed: the sim assumes the state machine runs the
+// ws2812 program (10 PIO cycles per bit, one word of pull_threshold
+// bits per FIFO entry), and only keeps what it needs to time the DMA
+// transfers that feed it (see hardware/dma.h).
+#include <stdint.h>
+#include "../hexBoardSim.h"
+
+struct pio_program_t {
+  const uint16_t* instructions;
+  uint8_t length;
+  int8_t origin;
+};
+
+struct pio_sm_config {
+  float clkdiv = 1.0f;
+  unsigned pull_threshold = 32;
+};
+
+enum pio_fifo_join {
+  PIO_FIFO_JOIN_NONE = 0,
+  PIO_FIFO_JOIN_TX = 1,
+  PIO_FIFO_JOIN_RX = 2,
+};
+
+using PIO = sim_pio_t*;
+#define pio0 (&sim_board.pio[0])
+#define pio1 (&sim_board.pio[1])
+
+inline unsigned pio_add_program(PIO pio, const pio_program_t* program) {
+  unsigned offset = pio->used;
+  pio->used += program->length;
+  return offset;
+}
+inline int pio_claim_unused_sm(PIO pio, bool required) {
+  (void)required;
+  return pio->claimed++;
+}
+inline void pio_gpio_init(PIO pio, unsigned pin) {
+  (void)pio;
+  (void)pin;
+}
+inline void pio_sm_set_consecutive_pindirs(PIO pio, unsigned sm, unsigned pin, unsigned count, bool out) {
+  (void)pio;
+  (void)sm;
+  (void)pin;
+  (void)count;
+  (void)out;
+}
+inline pio_sm_config pio_get_default_sm_config() {
+  return pio_sm_config();
+}
+inline void sm_config_set_wrap(pio_sm_config* c, unsigned wrap_target, unsigned wrap) {
+  (void)c;
+  (void)wrap_target;
+  (void)wrap;
+}
+inline void sm_config_set_sideset(pio_sm_config* c, unsigned bit_count, bool optional, bool pindirs) {
+  (void)c;
+  (void)bit_count;
+  (void)optional;
+  (void)pindirs;
+}
+inline void sm_config_set_sideset_pins(pio_sm_config* c, unsigned pin) {
+  (void)c;
+  (void)pin;
+}
+inline void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, unsigned pull_threshold) {
+  (void)shift_right;
+  (void)autopull;
+  c->pull_threshold = pull_threshold;
+}
+inline void sm_config_set_fifo_join(pio_sm_config* c, pio_fifo_join join) {
+  (void)c;
+  (void)join;
+}
+inline void sm_config_set_clkdiv(pio_sm_config* c, float div) {
+  c->clkdiv = div;
+}
+inline void pio_sm_init(PIO pio, unsigned sm, unsigned offset, const pio_sm_config* c) {
+  (void)offset;
+  // one bit every 10 cycles of the divided clock
+  pio->bit_nS[sm] = c->clkdiv * 10 * 1e9 / 133'000'000;
+  pio->bits_per_word[sm] = c->pull_threshold;
+}
+inline void pio_sm_set_enabled(PIO pio, unsigned sm, bool enabled) {
+  (void)pio;
+  (void)sm;
+  (void)enabled;
+}
+// DREQ numbers are (pio index * 8) + sm for TX
+inline unsigned pio_get_dreq(PIO pio, unsigned sm, bool is_tx) {
+  (void)is_tx;
+  return (unsigned)(pio - sim_board.pio) * 8 + sm;
+}
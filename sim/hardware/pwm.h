@@ -0,0 +1,35 @@
+#pragma once
+// host stand-in for the pico-sdk PWM block.
+// levels written to a pin are captured by the sim board.
+#include "../hexBoardSim.h"
+
+enum gpio_function {
+  GPIO_FUNC_PWM = 4,
+};
+
+inline void gpio_set_function(unsigned pin, gpio_function fn) {
+  (void)pin;
+  (void)fn;
+}
+inline unsigned pwm_gpio_to_slice_num(unsigned pin) {
+  return (pin >> 1) & 7;
+}
+inline void pwm_set_phase_correct(unsigned slice, bool phase_correct) {
+  (void)slice;
+  (void)phase_correct;
+}
+inline void pwm_set_wrap(unsigned slice, uint16_t wrap) {
+  (void)slice;
+  (void)wrap;
+}
+inline void pwm_set_clkdiv(unsigned slice, float divider) {
+  (void)slice;
+  (void)divider;
+}
+inline void pwm_set_enabled(unsigned slice, bool enabled) {
+  (void)slice;
+  (void)enabled;
+}
+inline void pwm_set_gpio_level(unsigned pin, uint16_t level) {
+  sim_board.write_pwm(pin, level);
+}
@@ -0,0 +1,18 @@
+#pragma once
+// host stand-in for the pico-sdk timer block, driven by the virtual clock
+#include <stdint.h>
+#include "../hexBoardSim.h"
+
+typedef volatile uint32_t io_rw_32;
+
+#define timer_hw (&sim_board.timer)
+
+inline void hw_set_bits(io_rw_32* addr, uint32_t mask) {
+  *addr |= mask;
+}
+inline void hw_clear_bits(io_rw_32* addr, uint32_t mask) {
+  *addr &= ~mask;
+}
+inline uint64_t time_us_64() {
+  return sim_board.now();
+}
@@ -0,0 +1,217 @@
+// Host-native simulation build of the HexBoard firmware.
+//
+// The Arduino build only compiles the sketch and src/, so this folder
+// is invisible to it. To build the simulator on Linux / macOS:
+//
+//   g++ -std=gnu++17 -O2 -I sim -o hexboard_sim sim/hexBoardSim.cpp
+//
+// and to run it:
+//
+//   ./hexboard_sim [-t trace.txt] [-u run_uS] [-l loop_uS] [-p pwm.raw]
+//                  [-a] [-k col mux reads.txt] [-f flash_dir] [-i frames.ppm]
+//                  [-c] [-g gap_uS] [-e expected.log] [-w actual.log] [-q]
+//
+//   -t  scripted key / rotary trace (format in hexBoardSim.h)
+//   -u  virtual microseconds to run (default: end of trace + 1 s)
+//   -l  virtual cost of one pass of loop() on core 0 (default 100 uS)
+//   -p  write every PWM level on the piezo pin to a raw 8-bit file
+//   -a  treat every key column as analog (firmware 2.0 hardware); keys
+//       with nothing scripted rest at the analog "up" calibration level
+//   -k  write every read the scanner makes of one key to a text file
+//   -f  keep LittleFS files in this host folder, so they last between
+//       runs (default: in memory for the one run)
+//   -i  write every LED frame sent to a PPM image, one row of pixels
+//       per frame, in the order of the strip. dithered colors show as
+//       the pattern of steps they flicker between
+//   -c  check the run: fail it if any LED frame was torn, overlapped
+//       or unlatched, or if two PWM writes were further apart than
+//       the gap budget
+//   -g  the gap budget for -c (default: one audio sample period plus
+//       one hardware tick, i.e. no sample was dropped)
+//   -e  check (as -c) and also compare the log / MIDI lines with this
+//       file, line for line
+//   -w  write the log / MIDI lines to this file, e.g. to make the
+//       expected log for a new trace
+//   -q  suppress log / MIDI lines, print the summary only
+//
+// The exit code is 1 if the trace cannot be read or a check failed,
+// so runs can be scripted (see check.sh).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  const char* pwmPath = nullptr;
+  const char* keyPath = nullptr;
+  const char* imagePath = nullptr;
+  const char* expectedPath = nullptr;
+  const char* logPath = nullptr;
+  bool check = false;
+  uint64_t gap_budget_uS = actual_audio_sample_period_in_uS + hardware_tick_period_in_uS;
+  bool analog = false;
+  uint64_t run_uS = 0;
+  uint64_t loop_uS = 100;
+  for (int i = 1; i < argc; ++i) {
+    if      (!strcmp(argv[i], "-t") && i + 1 < argc) { tracePath = argv[++i]; }
+    else if (!strcmp(argv[i], "-u") && i + 1 < argc) { run_uS = strtoull(argv[++i], nullptr, 10); }
+    else if (!strcmp(argv[i], "-l") && i + 1 < argc) { loop_uS = strtoull(argv[++i], nullptr, 10); }
+    else if (!strcmp(argv[i], "-p") && i + 1 < argc) { pwmPath = argv[++i]; }
+    else if (!strcmp(argv[i], "-a")) { analog = true; }
+    else if (!strcmp(argv[i], "-k") && i + 3 < argc) {
+      unsigned c = strtoul(argv[++i], nullptr, 10);
+      unsigned m = strtoul(argv[++i], nullptr, 10);
+      sim_board.key_capture = (c << 8) | m;
+      keyPath = argv[++i];
+    }
+    else if (!strcmp(argv[i], "-f") && i + 1 < argc) { LittleFS.host_dir = argv[++i]; }
+    else if (!strcmp(argv[i], "-i") && i + 1 < argc) { imagePath = argv[++i]; }
+    else if (!strcmp(argv[i], "-c")) { check = true; }
+    else if (!strcmp(argv[i], "-g") && i + 1 < argc) { gap_budget_uS = strtoull(argv[++i], nullptr, 10); }
+    else if (!strcmp(argv[i], "-e") && i + 1 < argc) { expectedPath = argv[++i]; check = true; }
+    else if (!strcmp(argv[i], "-w") && i + 1 < argc) { logPath = argv[++i]; }
+    else if (!strcmp(argv[i], "-q")) { sim_board.quiet = true; }
+    else {
+      fprintf(stderr, "usage: %s [-t trace] [-u run_uS] [-l loop_uS] [-p pwm.raw]"
+        " [-a] [-k col mux reads.txt] [-f flash_dir] [-i frames.ppm]"
+        " [-c] [-g gap_uS] [-e expected.log] [-w actual.log] [-q]\n", argv[0]);
+      return 2;
+    }
+  }
+  sim_board.attach_key_matrix(colPins, muxPins);
+  sim_board.attach_rotary(rotaryPinA, rotaryPinB, rotaryPinC);
+  if (tracePath && !sim_board.load_trace(tracePath)) {
+    fprintf(stderr, "could not read trace %s\n", tracePath);
+    return 1;
+  }
+  if (pwmPath) {
+    sim_board.pwm_out = fopen(pwmPath, "wb");
+    sim_board.pwm_capture_pin = piezoPin;
+  }
+  if (keyPath) {
+    sim_board.key_out = fopen(keyPath, "w");
+  }
+  sim_board.led_keep_frames = (imagePath != nullptr);
+  sim_board.keep_log = (expectedPath || logPath);
+  if (!run_uS) {
+    run_uS = sim_board.trace_end() + 1'000'000;
+  }
+
+  // core 0 runs setup() to completion before core 1 leaves setup1()
+  setup();
+  if (analog) {
+    sim_board.key_rest_level = default_analog_calibration_up + 32;
+    keyboard_setup(std::vector<bool>(colPins.size(), true));
+  }
+  setup1();
+  sim_board.core1_loop = loop1;
+
+  sim_timing_t loop_timing;
+  while (sim_board.now() < run_uS) {
+    uint64_t before = sim_board.now();
+    auto start = std::chrono::steady_clock::now();
+    loop();
+    auto stop = std::chrono::steady_clock::now();
+    loop_timing.add(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    // loop() that never waits still takes time on the real core
+    if (sim_board.now() == before) {
+      sim_board.advance(loop_uS);
+    }
+  }
+  if (sim_board.pwm_out) {
+    fclose(sim_board.pwm_out);
+  }
+  if (sim_board.key_out) {
+    fclose(sim_board.key_out);
+  }
+  if (imagePath && !sim_board.led_sent_frames.empty()) {
+    const auto& frames = sim_board.led_sent_frames;
+    FILE* image = fopen(imagePath, "wb");
+    fprintf(image, "P6\n%zu %zu\n255\n", frames[0].size(), frames.size());
+    for (const auto& f : frames) {
+      for (uint32_t grb : f) {
+        fputc((grb >> 16) & 0xFF, image);   // r
+        fputc((grb >> 24) & 0xFF, image);   // g
+        fputc((grb >> 8) & 0xFF, image);    // b
+      }
+    }
+    fclose(image);
+  }
+
+  // loop() time includes the IRQs that fired during its delay() calls
+  printf("---- summary after %llu virtual uS ----\n", (unsigned long long)sim_board.now());
+  printf("trace events applied: %llu\n", (unsigned long long)sim_board.events_applied);
+  printf("irq:    %10llu calls, mean %6llu nS, max %8llu nS (host)\n",
+    (unsigned long long)sim_board.irq_timing.calls,
+    (unsigned long long)sim_board.irq_timing.mean_nS(),
+    (unsigned long long)sim_board.irq_timing.max_nS);
+  printf("gpio:   %10llu interrupts\n", (unsigned long long)sim_board.gpio_irqs);
+  printf("loop(): %10llu calls, mean %6llu nS, max %8llu nS (host)\n",
+    (unsigned long long)loop_timing.calls,
+    (unsigned long long)loop_timing.mean_nS(),
+    (unsigned long long)loop_timing.max_nS);
+  printf("pwm writes: %llu, level changes: %llu, longest gap %llu uS\n",
+    (unsigned long long)sim_board.pwm_writes,
+    (unsigned long long)sim_board.pwm_changes,
+    (unsigned long long)sim_board.pwm_max_gap_uS);
+  printf("led frames: %llu, changed %llu, torn %llu, unlatched %llu, overlapped %llu\n",
+    (unsigned long long)sim_board.led_frames,
+    (unsigned long long)sim_board.led_changed,
+    (unsigned long long)sim_board.led_torn,
+    (unsigned long long)sim_board.led_unlatched,
+    (unsigned long long)sim_board.led_overlapped);
+  printf("midi messages: %llu\n", (unsigned long long)sim_board.midi_messages);
+
+  if (logPath) {
+    FILE* out = fopen(logPath, "w");
+    for (const auto& line : sim_board.log_lines) {
+      fprintf(out, "%s\n", line.c_str());
+    }
+    fclose(out);
+  }
+  if (!check) {
+    return 0;
+  }
+  unsigned failed = 0;
+  auto fail = [&](const std::string& why) {
+    printf("check failed: %s\n", why.c_str());
+    ++failed;
+  };
+  if (sim_board.led_torn || sim_board.led_overlapped || sim_board.led_unlatched) {
+    fail("LED frames torn " + std::to_string(sim_board.led_torn)
+      + ", overlapped " + std::to_string(sim_board.led_overlapped)
+      + ", unlatched " + std::to_string(sim_board.led_unlatched));
+  }
+  if (sim_board.pwm_max_gap_uS > gap_budget_uS) {
+    fail("PWM gap " + std::to_string(sim_board.pwm_max_gap_uS)
+      + " uS, budget " + std::to_string(gap_budget_uS) + " uS");
+  }
+  if (expectedPath) {
+    std::ifstream f(expectedPath);
+    std::vector<std::string> expected;
+    std::string line;
+    while (std::getline(f, line)) {
+      expected.emplace_back(line);
+    }
+    const auto& actual = sim_board.log_lines;
+    if (!f.eof()) {
+      fail(std::string("could not read ") + expectedPath);
+    } else if (actual != expected) {
+      size_t n = 0;
+      while (n < actual.size() && n < expected.size() && actual[n] == expected[n]) {
+        ++n;
+      }
+      fail(std::string("log differs from ") + expectedPath + " at line " + std::to_string(n + 1)
+        + "\n  expected: " + (n < expected.size() ? expected[n] : "(end)")
+        + "\n  actual:   " + (n < actual.size() ? actual[n] : "(end)"));
+    }
+  }
+  if (failed) {
+    return 1;
+  }
+  printf("check passed\n");
+  return 0;
+}
@@ -0,0 +1,418 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <array>
+#include <vector>
+#include <map>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+// Host-native stand-in for the RP2040 HexBoard.
+// The firmware never sees this file directly; the stand-in headers
+// (Arduino.h, hardware/timer.h, etc.) in this folder forward all of
+// their calls to the one sim_board object defined here.
+//
+// Time is a virtual microsecond clock. It only moves when the firmware
+// calls delay() / delayMicroseconds(), or when the sim main advances it
+// between passes of loop(). As the clock moves, the board
+//   - applies any scripted key / rotary trace events that are due,
+//   - runs the handler of any pin interrupt whose pin changed,
+//   - fires any armed timer alarm whose time has come (i.e. the IRQ),
+//   - finishes any LED transfer (DMA into the PIO) that is done,
+//   - gives core 1 a pass through loop1() in between.
+// Everything is single-threaded and deterministic, so two runs of the
+// same trace produce identical output.
+
+// one line of a scripted trace file:
+//   <time_uS> key    <col> <mux> <level>
+//   <time_uS> rotary <A> <B>
+//   <time_uS> click  <level>
+//   <time_uS> pin    <gpio> <level>
+//   <time_uS> serial <text typed into the serial monitor>
+// lines beginning with # are ignored.
+struct sim_event_t {
+  uint64_t time_uS;
+  unsigned kind;
+  int arg[3];
+  std::string text;
+};
+enum {
+  sim_key_event = 0,
+  sim_rotary_event = 1,
+  sim_click_event = 2,
+  sim_pin_event = 3,
+  sim_serial_event = 4,
+};
+
+// run-time cost of a callback, measured on the host clock
+struct sim_timing_t {
+  uint64_t calls = 0;
+  uint64_t total_nS = 0;
+  uint64_t max_nS = 0;
+  void add(uint64_t nS) {
+    ++calls;
+    total_nS += nS;
+    if (nS > max_nS) {
+      max_nS = nS;
+    }
+  }
+  uint64_t mean_nS() const {
+    return (calls ? total_nS / calls : 0);
+  }
+};
+
+// RP2040 alarm registers arm themselves when written.
+struct sim_alarm_reg {
+  uint32_t value = 0;
+  bool armed = false;
+  sim_alarm_reg& operator=(uint32_t v) {
+    value = v;
+    armed = true;
+    return *this;
+  }
+  operator uint32_t() const {
+    return value;
+  }
+};
+
+// only the registers the firmware touches are modeled
+struct sim_timer_hw_t {
+  volatile uint32_t timerawh = 0;
+  volatile uint32_t timerawl = 0;
+  sim_alarm_reg alarm[4];
+  volatile uint32_t armed = 0;
+  volatile uint32_t inte = 0;
+  volatile uint32_t intr = 0;
+};
+
+// a PIO block; only the ws2812 output timing is modeled (see hardware/pio.h)
+struct sim_pio_t {
+  volatile uint32_t txf[4] = {};
+  unsigned used = 0;       // instruction memory
+  int claimed = 0;         // state machines
+  double bit_nS[4] = {};
+  unsigned bits_per_word[4] = {};
+};
+
+using sim_irq_handler = void (*)(void);
+
+class sim_board_obj {
+  private:
+    uint64_t _now_uS = 0;
+    bool _inIRQ = false;
+    bool _inCore1 = false;
+    std::vector<sim_event_t> _trace;
+    size_t _traceIndex = 0;
+    // levels driven onto GPIO (by firmware or trace); pins float high.
+    // a fixed array, so that pin writes from the firmware never allocate
+    std::array<int, 64> _pinLevel = make_pin_levels();
+    static std::array<int, 64> make_pin_levels() {
+      std::array<int, 64> a;
+      a.fill(1);
+      return a;
+    }
+    std::map<unsigned, int> _keyLevel;   // key matrix, indexed by (col << 8) | mux
+    std::vector<unsigned> _colPins;
+    std::vector<unsigned> _muxPins;
+    unsigned _rotaryA = 0;
+    unsigned _rotaryB = 0;
+    unsigned _rotaryC = 0;
+    std::map<unsigned, sim_irq_handler> _pinHandler;   // attachInterrupt(), CHANGE only
+    std::vector<unsigned> _pinPending;                 // pins that changed with a handler attached
+    // the LED transfer in flight: where the DMA reads from, and what
+    // was there when it started
+    const uint32_t* _ledSource = nullptr;
+    std::vector<uint32_t> _ledFrame;
+    uint64_t _ledEnd = 0;
+    bool _ledActive = false;
+    uint64_t _lastPwm_uS = 0;
+    void finish_led_transfer() {
+      _ledActive = false;
+      if (memcmp(_ledSource, _ledFrame.data(), _ledFrame.size() * sizeof(uint32_t))) {
+        ++led_torn;
+      }
+    }
+    void set_level(unsigned pin, int level) {
+      int was = _pinLevel[pin];
+      _pinLevel[pin] = level;
+      if (level != was && _pinHandler.count(pin)) {
+        _pinPending.push_back(pin);
+      }
+    }
+    void set_clock(uint64_t t) {
+      _now_uS = t;
+      timer.timerawh = (uint32_t)(t >> 32);
+      timer.timerawl = (uint32_t)(t);
+    }
+    // alarms compare against the low 32 bits of the clock only
+    uint64_t alarm_time(unsigned a) {
+      uint64_t t = (_now_uS & 0xFFFFFFFF00000000ull) | timer.alarm[a].value;
+      if (t < _now_uS) {
+        t += (1ull << 32);
+      }
+      return t;
+    }
+    void apply_event(const sim_event_t& e) {
+      switch (e.kind) {
+        case sim_key_event:
+          _keyLevel[(e.arg[0] << 8) | e.arg[1]] = e.arg[2];
+          break;
+        case sim_rotary_event:
+          set_level(_rotaryA, e.arg[0]);
+          set_level(_rotaryB, e.arg[1]);
+          break;
+        case sim_click_event:
+          set_level(_rotaryC, e.arg[0]);
+          break;
+        case sim_pin_event:
+          set_level(e.arg[0], e.arg[1]);
+          break;
+        case sim_serial_event:
+          serial_input += e.text;
+          break;
+        default:
+          break;
+      }
+      ++events_applied;
+    }
+    void fire_alarm(unsigned a) {
+      timer.alarm[a].armed = false;
+      timer.intr |= (1u << a);
+      if (!((timer.inte >> a) & 1) || !irq_enabled[a] || !irq_handler[a]) {
+        return;
+      }
+      run_irq(irq_handler[a]);
+    }
+    void run_irq(sim_irq_handler f) {
+      _inIRQ = true;
+      auto start = std::chrono::steady_clock::now();
+      f();
+      auto stop = std::chrono::steady_clock::now();
+      _inIRQ = false;
+      irq_timing.add(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+    void run_core1() {
+      if (!core1_loop || _inCore1 || _inIRQ) {
+        return;
+      }
+      _inCore1 = true;
+      core1_loop();
+      _inCore1 = false;
+    }
+  public:
+    sim_timer_hw_t timer;
+    sim_pio_t pio[2];
+    int dma_claimed = 0;
+    unsigned dma_dreq = 0;     // the one DMA channel feeds this PIO state machine
+    sim_irq_handler irq_handler[32] = {};
+    bool irq_enabled[32] = {};
+    sim_timing_t irq_timing;
+    void (*core1_loop)() = nullptr;
+    // level a column pin reads back when no key is scripted there
+    int key_rest_level = 1;
+    // capture
+    std::map<unsigned, unsigned> pwm_level;
+    uint64_t pwm_writes = 0;
+    uint64_t pwm_changes = 0;
+    uint64_t pwm_max_gap_uS = 0;   // longest time between two PWM writes
+    FILE* pwm_out = nullptr;
+    unsigned pwm_capture_pin = 0;
+    uint64_t events_applied = 0;
+    uint64_t gpio_irqs = 0;
+    // LED frames: sent, different from the one before, changed while
+    // being sent, started too soon after the last one for the strip
+    // to latch, started while the last one was still going out
+    uint64_t led_frames = 0;
+    uint64_t led_changed = 0;
+    uint64_t led_torn = 0;
+    uint64_t led_unlatched = 0;
+    uint64_t led_overlapped = 0;
+    // every LED frame sent, as sent (GRB in the top 24 bits), if kept
+    bool led_keep_frames = false;
+    std::vector<std::vector<uint32_t>> led_sent_frames;
+    // every read of one key, "<time_uS> <level>" per line
+    FILE* key_out = nullptr;
+    unsigned key_capture = 0;   // (col << 8) | mux
+    std::string serial_input;   // typed by the trace, not yet read by the firmware
+    uint64_t midi_messages = 0;
+    bool quiet = false;
+    // every log / MIDI line printed, if kept (for checking against an expected log)
+    bool keep_log = false;
+    std::vector<std::string> log_lines;
+
+    uint64_t now() {
+      return _now_uS;
+    }
+    void attach_key_matrix(const std::vector<unsigned>& colPins, const std::vector<unsigned>& muxPins) {
+      _colPins = colPins;
+      _muxPins = muxPins;
+    }
+    // drive a key directly, as a trace "key" line would
+    void set_key(unsigned col, unsigned mux, int level) {
+      _keyLevel[(col << 8) | mux] = level;
+    }
+    void attach_rotary(unsigned A, unsigned B, unsigned C) {
+      _rotaryA = A;
+      _rotaryB = B;
+      _rotaryC = C;
+    }
+    bool load_trace(const std::string& path) {
+      std::ifstream f(path);
+      if (!f.is_open()) {
+        return false;
+      }
+      std::string line;
+      while (std::getline(f, line)) {
+        if (line.empty() || line[0] == '#') {
+          continue;
+        }
+        std::istringstream s(line);
+        sim_event_t e = {0, 0, {0, 0, 0}, ""};
+        std::string kind;
+        if (!(s >> e.time_uS >> kind)) {
+          continue;
+        }
+        if      (kind == "key")    { e.kind = sim_key_event;    s >> e.arg[0] >> e.arg[1] >> e.arg[2]; }
+        else if (kind == "rotary") { e.kind = sim_rotary_event; s >> e.arg[0] >> e.arg[1]; }
+        else if (kind == "click")  { e.kind = sim_click_event;  s >> e.arg[0]; }
+        else if (kind == "pin")    { e.kind = sim_pin_event;    s >> e.arg[0] >> e.arg[1]; }
+        else if (kind == "serial") { e.kind = sim_serial_event; s >> std::ws; std::getline(s, e.text); }
+        else {
+          fprintf(stderr, "trace %s: unknown event \"%s\"\n", path.c_str(), kind.c_str());
+          return false;
+        }
+        _trace.emplace_back(e);
+      }
+      return true;
+    }
+    uint64_t trace_end() {
+      return (_trace.empty() ? 0 : _trace.back().time_uS);
+    }
+    // move the virtual clock forward, servicing alarms, trace events and core 1 on the way
+    void advance(uint64_t dt_uS) {
+      uint64_t target = _now_uS + dt_uS;
+      do {
+        uint64_t next = target;
+        if (_traceIndex < _trace.size() && _trace[_traceIndex].time_uS < next) {
+          next = (_trace[_traceIndex].time_uS < _now_uS ? _now_uS : _trace[_traceIndex].time_uS);
+        }
+        for (unsigned a = 0; a < 4; ++a) {
+          if (timer.alarm[a].armed) {
+            uint64_t t = alarm_time(a);
+            if (t < next) {
+              next = t;
+            }
+          }
+        }
+        if (_ledActive && _ledEnd < next) {
+          next = (_ledEnd < _now_uS ? _now_uS : _ledEnd);
+        }
+        set_clock(next);
+        if (_ledActive && _ledEnd <= _now_uS) {
+          finish_led_transfer();
+        }
+        while (_traceIndex < _trace.size() && _trace[_traceIndex].time_uS <= _now_uS) {
+          apply_event(_trace[_traceIndex++]);
+        }
+        if (!_inIRQ) {
+          // GPIO interrupts, one per pin that changed
+          for (size_t i = 0; i < _pinPending.size(); ++i) {
+            run_irq(_pinHandler[_pinPending[i]]);
+            ++gpio_irqs;
+          }
+          _pinPending.clear();
+          for (unsigned a = 0; a < 4; ++a) {
+            if (timer.alarm[a].armed && alarm_time(a) == _now_uS) {
+              fire_alarm(a);
+            }
+          }
+        }
+        run_core1();
+      } while (_now_uS < target);
+    }
+    // GPIO
+    void attach_pin_irq(unsigned pin, sim_irq_handler f) {
+      _pinHandler[pin] = f;
+    }
+    void detach_pin_irq(unsigned pin) {
+      _pinHandler.erase(pin);
+    }
+    void write_pin(unsigned pin, int level) {
+      _pinLevel[pin] = level;
+    }
+    int read_pin(unsigned pin) {
+      for (unsigned c = 0; c < _colPins.size(); ++c) {
+        if (_colPins[c] == pin) {
+          unsigned m = 0;
+          for (unsigned b = 0; b < _muxPins.size(); ++b) {
+            m |= (read_pin(_muxPins[b]) & 1) << b;
+          }
+          auto k = _keyLevel.find((c << 8) | m);
+          int level = (k == _keyLevel.end() ? key_rest_level : k->second);
+          if (key_out && ((c << 8) | m) == key_capture) {
+            fprintf(key_out, "%llu %d\n", (unsigned long long)_now_uS, level);
+          }
+          return level;
+        }
+      }
+      return _pinLevel[pin];
+    }
+    void write_pwm(unsigned pin, unsigned level) {
+      if (pwm_writes && _now_uS - _lastPwm_uS > pwm_max_gap_uS) {
+        pwm_max_gap_uS = _now_uS - _lastPwm_uS;
+      }
+      _lastPwm_uS = _now_uS;
+      ++pwm_writes;
+      auto p = pwm_level.find(pin);
+      if (p == pwm_level.end() || p->second != level) {
+        ++pwm_changes;
+      }
+      pwm_level[pin] = level;
+      if (pwm_out && pin == pwm_capture_pin) {
+        fputc((int)(level & 0xFF), pwm_out);
+      }
+    }
+    // LED strip: the DMA starts reading n words from src into the PIO
+    void start_led_transfer(const uint32_t* src, unsigned n) {
+      if (_ledActive) {
+        ++led_overlapped;
+        finish_led_transfer();
+      } else if (led_frames && _now_uS < _ledEnd + 280) {
+        ++led_unlatched;
+      }
+      std::vector<uint32_t> frame(src, src + n);
+      if (!led_frames || frame != _ledFrame) {
+        ++led_changed;
+      }
+      if (led_keep_frames) {
+        led_sent_frames.push_back(frame);
+      }
+      _ledFrame = frame;
+      _ledSource = src;
+      const sim_pio_t& p = pio[dma_dreq / 8];
+      unsigned sm = dma_dreq % 8;
+      _ledEnd = _now_uS + (uint64_t)ceil(n * p.bits_per_word[sm] * p.bit_nS[sm] / 1000);
+      _ledActive = true;
+      ++led_frames;
+    }
+    bool led_transfer_busy() {
+      return _ledActive && _now_uS < _ledEnd;
+    }
+    // log and MIDI output land on stdout, prefixed with the virtual time
+    void print(const char* channel, const std::string& msg) {
+      char line[64];
+      snprintf(line, sizeof(line), "%12llu %-5s ", (unsigned long long)_now_uS, channel);
+      if (keep_log) {
+        log_lines.emplace_back(line + msg);
+      }
+      if (!quiet) {
+        printf("%s%s\n", line, msg.c_str());
+      }
+    }
+};
+
+inline sim_board_obj sim_board;
@@ -0,0 +1,93 @@
+// The analog key calibration is saved now and then, and a
+// save that fails is tried again soon, not a whole save period later.
+//
+// key_calibration_file_obj runs against a stand-in for the key scanner
+// (two analog keys and a digital one) on the virtual clock, with a
+// 10 s save period and a 1 s retry. Expected: no save while the keys
+// have not moved; once one has moved by the threshold, a save when the
+// period is up; with the flash full, a try every retry period (not every
+// loop) until it has room again, and then back to the save period; and
+// the file loads back into a fresh grid as the profiles that were saved.
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "../src/hexBoardHardware/calibrationFile.h"
+
+struct grid_obj {
+  std::array<key_profile_t, 3> profile = {{{500, 280}, {510, 290}, {1, 0}}};
+  unsigned buttonCount() {
+    return 3;
+  }
+  bool is_analog(unsigned i) {
+    return i < 2;
+  }
+  key_profile_t get_profile(unsigned i) {
+    return profile[i];
+  }
+  void set_profile(unsigned i, key_profile_t p) {
+    profile[i] = p;
+  }
+};
+
+grid_obj grid;
+key_calibration_file_obj<grid_obj, 3> file;
+
+unsigned failed = 0;
+void expect(const char* what, uint64_t want) {
+  bool ok = (LittleFS.writes == want);
+  printf("%-34s %llu saves %s\n", what, (unsigned long long)LittleFS.writes, (ok ? "ok" : "FAIL"));
+  failed += !ok;
+}
+// loop() for a while, once every mS
+void run_for(unsigned long mS) {
+  for (unsigned long i = 0; i < mS; ++i) {
+    file.autosave();
+    sim_board.advance(1000);
+  }
+}
+
+int main() {
+  sim_board.quiet = true;
+  file.setup(grid, "/key_calibration.bin", 10'000, 1'000, 4);
+  file.load();
+  run_for(30'000);
+  expect("keys still", 0);
+  grid.profile[1].rest += 3;
+  run_for(30'000);
+  expect("moved less than the threshold", 0);
+  grid.profile[1].rest += 1;
+  run_for(1);
+  expect("moved, long after boot", 1);
+  grid.profile[1].rest += 4;
+  run_for(5'000);
+  expect("moved again, before the period", 1);
+  run_for(5'000);
+  expect("once the period is up", 2);
+  grid.profile[0].bottom -= 10;
+  LittleFS.full = true;
+  run_for(20'000);
+  bool retrying = file.save_failed();
+  expect("flash full", 2);
+  // the first try when the period is up, then one a second
+  bool tries_ok = (LittleFS.refused >= 10 && LittleFS.refused <= 11);
+  printf("%-34s %llu tries %s\n", "  while full", (unsigned long long)LittleFS.refused,
+    (tries_ok ? "ok" : "FAIL"));
+  failed += !tries_ok;
+  LittleFS.full = false;
+  run_for(1'000);
+  expect("room again, within the retry", 3);
+  failed += !retrying || file.save_failed();
+  grid.profile[0].bottom -= 10;
+  run_for(5'000);
+  expect("moved, before the period", 3);
+
+  grid_obj fresh;
+  key_calibration_file_obj<grid_obj, 3> reload;
+  reload.setup(fresh, "/key_calibration.bin", 10'000, 1'000, 4);
+  bool loaded = reload.load();
+  bool same = loaded && fresh.profile[0].bottom == 270 && fresh.profile[1].rest == 518;
+  printf("loaded back: %s\n", (same ? "ok" : "FAIL"));
+  failed += !same;
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,57 @@
+// Core 0 never reads a calibration table that is half made, while the
+// scanner keeps remaking it.
+//
+// Two host threads share one key_calibration_obj. The writer, standing
+// in for the scanner's interrupt, tracks 20M reads that move the rest
+// and bottom levels all the time (half of them in warm-up, which takes
+// the rest level as read), so the table is remade on most reads. The
+// reader, standing in for core 0, takes read_table() and profile() as
+// fast as it can. On a multi-core host the two really run at once.
+// Expected: every table read is the one make_table() works out from its
+// own rest and bottom, and the writer did remake the table millions of
+// times while the reader was reading.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include "../src/hexBoardHardware/calibration.h"
+
+key_calibration_obj cal;
+std::atomic<bool> done{false};
+
+// what make_table() gives for a rest and bottom
+bool whole(const key_table_t& t) {
+  int travel = t.rest - t.bottom;
+  int span = (t.rest - travel / 8) - (t.bottom + travel / 16);
+  return t.up == t.rest - travel / 8
+    && t.release == t.rest - travel / 16
+    && t.down == t.bottom + travel / 16
+    && t.scale == (span > 0 ? (((1u << key_pressure_bits) - 1) << 8) / span : 0);
+}
+
+int main() {
+  cal.seed({3000, 1200});
+  unsigned long long remade = 0;
+  std::thread writer([&] {
+    uint32_t seed = 1;
+    for (unsigned n = 0; n < 20'000'000; ++n) {
+      seed = seed * 1103515245 + 12345;
+      int level = 1000 + (seed >> 16) % 3000;
+      remade += cal.track(level, (n >> 10) & 1);
+    }
+    done.store(true);
+  });
+  unsigned long long reads = 0, torn = 0;
+  while (!(done.load())) {
+    key_table_t t = cal.read_table();
+    key_profile_t p = cal.profile();
+    torn += !(whole(t)) + (p.rest - p.bottom < key_calibration_min_travel);
+    ++reads;
+  }
+  writer.join();
+  bool ok = !torn && remade > 1'000'000 && whole(cal.read_table());
+  printf("table remade %llu times, read %llu times, %llu half made %s\n",
+    remade, reads, torn, (ok ? "ok" : "FAIL"));
+  return (ok ? 0 : 1);
+}
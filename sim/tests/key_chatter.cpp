@@ -0,0 +1,65 @@
+// An analog key held near its press threshold does not
+// chatter, however often it is read.
+//
+// The firmware is set up with every column analog, as on the board. One
+// key is pushed to its press threshold and held there with +-8 units of
+// noise that changes every 5-50 uS, for a virtual second, so the key is
+// hot and read many times per sweep. Then it goes back to rest.
+// Expected: exactly one press while it is held and one release after,
+// and nothing from any other key.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+int main() {
+  sim_board.quiet = true;
+  sim_board.attach_key_matrix(colPins, muxPins);
+  const int rest = default_analog_calibration_up + 32;
+  for (unsigned c = 0; c < colPins.size(); ++c) {
+    for (unsigned m = 0; m < (1u << muxPins.size()); ++m) {
+      sim_board.set_key(c, m, rest);
+    }
+  }
+  setup();
+  setup1();
+  keyboard_setup(std::vector<bool>(colPins.size(), true));
+  sim_board.advance(100'000);
+  key_event_t e;
+  while (pinGrid.read_event(e)) {
+  }
+
+  const unsigned c = 3, m = 7;
+  const unsigned key = pinGrid.linear_index(c, m);
+  key_profile_t p = pinGrid.get_profile(key);
+  const int up = p.rest - (p.rest - p.bottom) / 8;
+  unsigned presses = 0, releases = 0, others = 0;
+  auto drain = [&] {
+    while (pinGrid.read_event(e)) {
+      if (e.key != key) {
+        ++others;
+      } else if (e.edge == key_edge_press) {
+        ++presses;
+      } else {
+        ++releases;
+      }
+    }
+  };
+  srand(4);
+  uint64_t until = sim_board.now() + 1'000'000;
+  while (sim_board.now() < until) {
+    sim_board.set_key(c, m, up + rand() % 17 - 8);
+    sim_board.advance(5 + rand() % 46);
+    drain();
+  }
+  printf("held at %d +-8: %u presses, %u releases\n", up, presses, releases);
+  bool held_ok = (presses == 1 && releases == 0);
+  sim_board.set_key(c, m, rest);
+  sim_board.advance(100'000);
+  drain();
+  printf("back at rest:  %u presses, %u releases, %u from other keys\n", presses, releases, others);
+  bool ok = held_ok && presses == 1 && releases == 1 && !others;
+  printf("%s\n", (ok ? "ok" : "FAIL"));
+  return (ok ? 0 : 1);
+}
@@ -0,0 +1,97 @@
+// The time from a key's pin changing to its event.
+//
+// The firmware is set up as on the board, then keys are pressed and
+// released one at a time, each change landing at a different point of
+// the scan. After each change the virtual clock moves on in 10 uS steps
+// until read_event() gives the key's edge; the latency is the event's
+// own time stamp minus the time the pin changed.
+// Expected: every change gives exactly one event for that key, with the
+// right edge, and no latency is over the worst case: one sweep to reach
+// the key, plus one more sweep per debounce read, plus one frame for a
+// digital key (those are stepped once per frame, after the sweep).
+// Digital events carry a velocity of 0.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+void set_all_keys(int level) {
+  for (unsigned c = 0; c < colPins.size(); ++c) {
+    for (unsigned m = 0; m < (1u << muxPins.size()); ++m) {
+      sim_board.set_key(c, m, level);
+    }
+  }
+}
+
+// returns the number of failures
+unsigned measure(const char* name, int up, int down, bool digital) {
+  const unsigned long long sweep_uS =
+    pinGrid.get_sweep_deadline_in_polls() * keyboard_pin_reset_period_in_uS;
+  const unsigned reads = (keyboard_debounce_press_reads > keyboard_debounce_release_reads
+    ? keyboard_debounce_press_reads : keyboard_debounce_release_reads);
+  const unsigned long long limit_uS = sweep_uS * (1 + reads + (digital ? 1 : 0));
+  srand(2);
+  key_event_t e;
+  unsigned failed = 0;
+  unsigned long long total_uS = 0;
+  unsigned long long worst_uS = 0;
+  unsigned changes = 0;
+  for (unsigned n = 0; n < 200; ++n) {
+    unsigned c = rand() % colPins.size();
+    unsigned m = rand() % (1u << muxPins.size());
+    // land the change somewhere inside the sweep
+    sim_board.advance(rand() % sweep_uS);
+    for (int press = 1; press >= 0; --press) {
+      sim_board.set_key(c, m, (press ? down : up));
+      uint64_t changed_at = sim_board.now();
+      bool seen = false;
+      while (!seen && sim_board.now() - changed_at <= 2 * limit_uS) {
+        sim_board.advance(10);
+        while (pinGrid.read_event(e)) {
+          bool right = (e.key == pinGrid.linear_index(c, m))
+            && (e.edge == (press ? key_edge_press : key_edge_release))
+            && (!digital || e.velocity == 0);
+          if (!right || seen) {
+            ++failed;
+          }
+          seen = true;
+        }
+      }
+      unsigned long long latency_uS = (uint32_t)(e.time_uS - (uint32_t)changed_at);
+      if (!seen || latency_uS > limit_uS) {
+        ++failed;
+      }
+      if (seen) {
+        total_uS += latency_uS;
+        worst_uS = (latency_uS > worst_uS ? latency_uS : worst_uS);
+        ++changes;
+      }
+    }
+  }
+  printf("%s keys: %u changes, mean %llu uS, worst %llu uS, limit %llu uS %s\n",
+    name, changes, (changes ? total_uS / changes : 0), worst_uS, limit_uS,
+    (failed ? "FAIL" : "ok"));
+  return failed;
+}
+
+int main() {
+  sim_board.quiet = true;
+  sim_board.attach_key_matrix(colPins, muxPins);
+  setup();
+  setup1();
+  unsigned failed = measure("digital", 1, 0, true);
+
+  // the keys the digital run left behind go back to rest before the
+  // analog keys take their calibration from them
+  set_all_keys(default_analog_calibration_up + 32);
+  keyboard_setup(std::vector<bool>(colPins.size(), true));
+  sim_board.advance(100'000);
+  key_event_t e;
+  while (pinGrid.read_event(e)) {
+  }
+  failed += measure("analog", default_analog_calibration_up + 32,
+    default_analog_calibration_down, false);
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,116 @@
+// What a full frame of the digital key matrix costs, with the scanner
+// finding the edges word-wide, against core 0 calling read_keypress()
+// on every key as it used to.
+//
+// The firmware is set up as on the board, with every column digital.
+// poll() is called directly, once per key, for each frame, and 8 keys
+// change every 64 frames. Each frame is then finished one of two ways:
+//   events        take_snapshot(), then read_event() until the queue
+//                 is empty (the scanner found the edges, word-wide)
+//   read_keypress take_snapshot(), then read_keypress() on all 160
+//                 keys (core 0 finding the edges, as before)
+// and the two are timed with the host clock, best of 5 runs.
+// Expected: one frame published per sweep, and both ways see every
+// press and release exactly once. The time per frame of each is printed
+// but not checked, as host timings are too noisy to gate on.
+
+#include <stdio.h>
+#include <chrono>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+const unsigned frames = 20'000;
+const unsigned change_every = 64;
+const unsigned changes = 8;
+
+struct result_t {
+  double best_uS = 1e9;
+  unsigned presses = 0;
+  unsigned releases = 0;
+  unsigned published = 0;
+};
+
+void set_all(int level) {
+  for (unsigned c = 0; c < colPins.size(); ++c) {
+    for (unsigned m = 0; m < (1u << muxPins.size()); ++m) {
+      sim_board.set_key(c, m, level);
+    }
+  }
+}
+
+// one run of frames; by_event picks how core 0 finds the edges
+void run(result_t& r, bool by_event) {
+  const unsigned keys = pinGrid.buttonCount();
+  set_all(1);
+  // a few frames at rest, so both ways start with every key up
+  for (unsigned f = 0; f < 8; ++f) {
+    for (unsigned k = 0; k < keys; ++k) {
+      pinGrid.poll();
+    }
+    pinGrid.take_snapshot();
+    key_event_t e;
+    while (pinGrid.read_event(e)) {
+    }
+  }
+  r.presses = 0;
+  r.releases = 0;
+  unsigned first = pinGrid.get_frame_count();
+  bool down = false;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned f = 0; f < frames; ++f) {
+    if (f % change_every == change_every / 2) {
+      down = !(down);
+      for (unsigned i = 0; i < changes; ++i) {
+        sim_board.set_key((i * 3) % colPins.size(), (i * 5) % (1u << muxPins.size()), (down ? 0 : 1));
+      }
+    }
+    for (unsigned k = 0; k < keys; ++k) {
+      pinGrid.poll();
+    }
+    pinGrid.take_snapshot();
+    if (by_event) {
+      key_event_t e;
+      while (pinGrid.read_event(e)) {
+        r.presses += (e.edge == key_edge_press);
+        r.releases += (e.edge == key_edge_release);
+      }
+    } else {
+      for (unsigned c = 0; c < pinGrid.colPinCount(); ++c) {
+        for (unsigned m = 0; m < pinGrid.muxPinMaxValue(); ++m) {
+          int k = pinGrid.read_keypress(m, c);
+          r.presses += (k == 1);
+          r.releases += (k == 2);
+        }
+      }
+    }
+  }
+  auto stop = std::chrono::steady_clock::now();
+  r.published = pinGrid.get_frame_count() - first;
+  double uS = std::chrono::duration<double, std::micro>(stop - start).count() / frames;
+  r.best_uS = (uS < r.best_uS ? uS : r.best_uS);
+}
+
+int main() {
+  sim_board.quiet = true;
+  sim_board.attach_key_matrix(colPins, muxPins);
+  setup();
+  setup1();
+  result_t events, keypress;
+  for (unsigned i = 0; i < 5; ++i) {
+    run(events, true);
+    run(keypress, false);
+  }
+  // each change of state is 8 presses or 8 releases
+  const unsigned want = (frames + change_every / 2) / change_every / 2 * changes;
+  unsigned failed = 0;
+  for (auto* r : {&events, &keypress}) {
+    bool ok = (r->published == frames) && r->presses == want && r->releases == want;
+    printf("%-13s %u frames: %u presses, %u releases (want %u), %.2f uS a frame %s\n",
+      (r == &events ? "events" : "read_keypress"), r->published, r->presses, r->releases,
+      want, r->best_uS, (ok ? "ok" : "FAIL"));
+    failed += !ok;
+  }
+  printf("read_keypress / events: %.2f\n", keypress.best_uS / events.best_uS);
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,99 @@
+// The hot reads of a held key make its pressure steadier, as core 0
+// reads it.
+//
+// The firmware is set up with every column analog, as on the board. One
+// key is pushed half way between its press and full-pressure levels and
+// held there with +-16 units of noise that changes every 5-50 uS, for a
+// virtual second after it has settled. Core 0's side is played by the test: a take_snapshot()
+// and a read_pressure() every mS, keeping one pressure per new frame.
+// This runs once with the firmware's scan schedule, where the key is hot,
+// and once with hot reads off (the plain sweep).
+// Expected: with hot reads, the pressure's standard deviation is under
+// a third of the plain sweep's (it comes out about a twelfth), and both
+// means are within 2% of where the key was held. The frames per second
+// are printed too: a hot key makes the sweep longer, so core 0 gets
+// fewer, steadier pressures.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+struct spread_t {
+  unsigned frames = 0;
+  double mean = 0;
+  double deviation = 0;
+};
+
+const unsigned c = 3, m = 7;
+
+// holds the key at level with noise; after the first 100 mS, which has
+// the press in it, keeps one pressure per frame for a second
+spread_t hold(int level, unsigned seed) {
+  std::vector<double> p;
+  srand(seed);
+  uint64_t next_read = sim_board.now();
+  uint64_t from = sim_board.now() + 100'000;
+  uint64_t until = from + 1'000'000;
+  while (sim_board.now() < until) {
+    sim_board.set_key(c, m, level + rand() % 33 - 16);
+    sim_board.advance(5 + rand() % 46);
+    if (sim_board.now() >= next_read) {
+      next_read += 1000;
+      if (pinGrid.take_snapshot() && sim_board.now() >= from) {
+        p.push_back(pinGrid.read_pressure(m, c));
+      }
+    }
+  }
+  spread_t s;
+  s.frames = p.size();
+  for (double x : p) {
+    s.mean += x / p.size();
+  }
+  for (double x : p) {
+    s.deviation += (x - s.mean) * (x - s.mean) / p.size();
+  }
+  s.deviation = sqrt(s.deviation);
+  return s;
+}
+
+int main() {
+  sim_board.quiet = true;
+  sim_board.attach_key_matrix(colPins, muxPins);
+  const int rest = default_analog_calibration_up + 32;
+  for (unsigned col = 0; col < colPins.size(); ++col) {
+    for (unsigned mux = 0; mux < (1u << muxPins.size()); ++mux) {
+      sim_board.set_key(col, mux, rest);
+    }
+  }
+  setup();
+  setup1();
+  keyboard_setup(std::vector<bool>(colPins.size(), true));
+  // the levels stay put, so the key's profile does not drift under the test
+  pinGrid.set_auto_calibration(false, 0);
+  sim_board.advance(100'000);
+  const unsigned key = pinGrid.linear_index(c, m);
+  key_profile_t profile = pinGrid.get_profile(key);
+  int travel = profile.rest - profile.bottom;
+  int up = profile.rest - travel / 8;
+  int down = profile.bottom + travel / 16;
+  const int held = (up + down) / 2;
+  double want = pinGrid.pressure_of(key, held);
+
+  spread_t hot = hold(held, 6);
+  sim_board.set_key(c, m, rest);
+  sim_board.advance(100'000);
+  pinGrid.set_scan_schedule(0, keyboard_hot_linger_sweeps, keyboard_hot_threshold);
+  spread_t plain = hold(held, 6);
+
+  printf("held at %d, pressure %.3f\n", held, want);
+  printf("hot reads:   %3u frames a second, pressure mean %.3f, standard deviation %.4f\n",
+    hot.frames, hot.mean, hot.deviation);
+  printf("plain sweep: %3u frames a second, pressure mean %.3f, standard deviation %.4f\n",
+    plain.frames, plain.mean, plain.deviation);
+  bool ok = (hot.deviation * 3 < plain.deviation)
+    && fabs(hot.mean - want) < 0.02 && fabs(plain.mean - want) < 0.02;
+  printf("%s\n", (ok ? "ok" : "FAIL"));
+  return (ok ? 0 : 1);
+}
@@ -0,0 +1,91 @@
+// Scanning the keys never touches the heap once setup() is done,
+// and how long one poll() of the scanner takes.
+//
+// The firmware is set up as on the board, then the timer interrupts run
+// for one virtual second while keys go up and down (every column
+// digital, then every column analog), and core 0 takes every frame and
+// event. Every operator new is counted while that runs.
+// Expected: no allocations in either run. Then poll() is called 2M times
+// back to back and the time per call is printed, but not checked (host
+// timings are too noisy to gate on). It is about 80-120 nS on an x86
+// host; the tick it runs in is 16 uS on the RP2040.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+bool counting = false;
+unsigned long long allocations = 0;
+void* operator new(size_t n) {
+  allocations += counting;
+  void* p = malloc(n ? n : 1);
+  if (!(p)) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void operator delete(void* p) noexcept {
+  free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+// one virtual second of key changes; returns the allocations made
+unsigned long long play_keys(int up, int down) {
+  // every key gets its entry in the sim's key map now, so the map does not allocate later
+  for (unsigned c = 0; c < colPins.size(); ++c) {
+    for (unsigned m = 0; m < (1u << muxPins.size()); ++m) {
+      sim_board.set_key(c, m, up);
+    }
+  }
+  srand(1);
+  key_event_t e;
+  unsigned events = 0;
+  allocations = 0;
+  counting = true;
+  for (unsigned step = 0; step < 1000; ++step) {
+    unsigned c = rand() % colPins.size();
+    unsigned m = rand() % (1u << muxPins.size());
+    sim_board.set_key(c, m, (rand() & 1 ? down : up));
+    sim_board.advance(1000);
+    pinGrid.take_snapshot();
+    while (pinGrid.read_event(e)) {
+      ++events;
+    }
+  }
+  counting = false;
+  printf("  %u events\n", events);
+  return allocations;
+}
+
+int main() {
+  sim_board.quiet = true;
+  sim_board.attach_key_matrix(colPins, muxPins);
+  setup();
+  setup1();
+  unsigned failed = 0;
+  unsigned long long n = play_keys(1, 0);
+  printf("digital keys: %llu allocations %s\n", n, (n ? "FAIL" : "ok"));
+  failed += (n != 0);
+
+  sim_board.key_rest_level = default_analog_calibration_up + 32;
+  keyboard_setup(std::vector<bool>(colPins.size(), true));
+  sim_board.advance(100'000);
+  n = play_keys(default_analog_calibration_up + 32, default_analog_calibration_down);
+  printf("analog keys:  %llu allocations %s\n", n, (n ? "FAIL" : "ok"));
+  failed += (n != 0);
+
+  const unsigned polls = 2'000'000;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < polls; ++i) {
+    pinGrid.poll();
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double nS = std::chrono::duration<double, std::nano>(stop - start).count() / polls;
+  printf("poll(): %.1f nS per call\n", nS);
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
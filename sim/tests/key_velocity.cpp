@@ -0,0 +1,236 @@
+// Key velocity and acceleration from the integer fit, on
+// synthetic press profiles, and what one read of the fit costs.
+//
+// Every profile is pushed into a key_motion_obj<8> one read at a time,
+// and after each read velocity_per_s() and acceleration_per_s2() are
+// compared with the same least-squares fits done in double precision
+// (clamped to the int32 range, as the integer ones are). The profiles:
+// presses at constant speed and at constant acceleration, read once per
+// sweep (and fast ones ten times as often) with a few uS of jitter,
+// which also have to come out within 2% of the speed and acceleration
+// they were made with, once the window is full, also when the sweep
+// takes twice as long part way through the press; rest-level noise
+// of +-8 read every 32 uS, which overflows an int32 and has to stop at
+// the end of the range with the right sign; and random levels at random
+// spacings. Expected: every value within 2 units (plus a millionth) of
+// the double one. Then push() + motion() + both values are timed over
+// 10M reads on the host, and the time per read is printed (about 20 nS
+// on an x86 host) but not checked, as host timings are too noisy.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "../src/hexBoardHardware/velocity.h"
+
+const unsigned window = 8;
+typedef key_motion_obj<window> motion_obj;
+
+double clamp(double v) {
+  return (v > INT32_MAX ? INT32_MAX : v < -INT32_MAX ? -INT32_MAX : v);
+}
+
+// least squares in double precision, on x = 0 .. count-1, over the
+// reads since the gap between two reads last changed (by the same rule)
+struct reference_obj {
+  std::vector<double> y;
+  std::vector<uint32_t> t;
+  void push(int16_t level, uint32_t at) {
+    if (y.size() >= 2) {
+      uint64_t gap = (uint64_t)(uint32_t)(at - t.back()) * (y.size() - 1);
+      uint64_t span = (uint32_t)(t.back() - t.front());
+      if (2 * gap > 3 * span || 3 * gap < 2 * span) {
+        y.erase(y.begin(), y.end() - 1);
+        t.erase(t.begin(), t.end() - 1);
+      }
+    }
+    y.push_back(level);
+    t.push_back(at);
+    if (y.size() > window) {
+      y.erase(y.begin());
+      t.erase(t.begin());
+    }
+  }
+  double span_uS() {
+    return (double)(uint32_t)(t.back() - t.front());
+  }
+  double velocity_per_s() {
+    size_t c = y.size();
+    if (c < 2 || !span_uS()) {
+      return 0;
+    }
+    double mx = (c - 1) / 2.0, my = 0, sxy = 0, sxx = 0;
+    for (size_t x = 0; x < c; ++x) {
+      my += y[x] / c;
+    }
+    for (size_t x = 0; x < c; ++x) {
+      sxy += (x - mx) * (y[x] - my);
+      sxx += (x - mx) * (x - mx);
+    }
+    return clamp(sxy / sxx * (c - 1) * 1e6 / span_uS());
+  }
+  double acceleration_per_s2() {
+    size_t c = y.size();
+    if (c < window || !span_uS()) {
+      return 0;
+    }
+    // y = a + b x + e x^2 by the normal equations
+    double s[5] = {}, r[3] = {};
+    for (size_t x = 0; x < c; ++x) {
+      double p = 1;
+      for (int i = 0; i < 5; ++i) {
+        s[i] += p;
+        if (i < 3) {
+          r[i] += p * y[x];
+        }
+        p *= x;
+      }
+    }
+    double m[3][4] = {{s[0], s[1], s[2], r[0]}, {s[1], s[2], s[3], r[1]}, {s[2], s[3], s[4], r[2]}};
+    for (int i = 0; i < 3; ++i) {
+      for (int j = i + 1; j < 3; ++j) {
+        double f = m[j][i] / m[i][i];
+        for (int k = i; k < 4; ++k) {
+          m[j][k] -= f * m[i][k];
+        }
+      }
+    }
+    double e = m[2][3] / m[2][2];
+    double per_read_s = span_uS() / (c - 1) / 1e6;
+    return clamp(2 * e / (per_read_s * per_read_s));
+  }
+};
+
+struct profile_t {
+  const char* name;
+  double speed;          // for presses: the speed (or acceleration) they were made with
+  double acceleration;
+  unsigned compares = 0;
+  unsigned failed = 0;
+  unsigned off_truth = 0;
+};
+
+bool close(int32_t got, double want) {
+  return fabs(got - want) <= 2 + fabs(want) * 1e-6;
+}
+
+// pushes level(t) read every gap (+ jitter) and compares. from read
+// slow_from on, the gap is twice as long, as when keys go hot
+void play(profile_t& p, double (*level)(double t_s, const profile_t&),
+  unsigned reads, unsigned gap_uS, unsigned jitter_uS, unsigned slow_from = ~0u) {
+  motion_obj k;
+  reference_obj ref;
+  uint32_t t = 4'000'000'000u;  // so the timer wraps part way through
+  double elapsed_uS = 0;
+  for (unsigned i = 0; i < reads; ++i) {
+    uint32_t at = t + (jitter_uS ? rand() % (2 * jitter_uS + 1) - jitter_uS : 0);
+    double v = level(elapsed_uS / 1e6, p);
+    int16_t y = (int16_t)lround(v);
+    k.push(y, at);
+    ref.push(y, at);
+    key_motion_t m = k.motion();
+    int32_t vel = motion_obj::velocity_per_s(m);
+    int32_t acc = motion_obj::acceleration_per_s2(m);
+    ++p.compares;
+    if (!close(vel, ref.velocity_per_s()) || !close(acc, ref.acceleration_per_s2())) {
+      if (!p.failed) {
+        printf("  read %u: velocity %d, want %.1f; acceleration %d, want %.1f\n",
+          i, vel, ref.velocity_per_s(), acc, ref.acceleration_per_s2());
+      }
+      ++p.failed;
+    }
+    // against the profile itself, once the window is full of it
+    if (i >= window && (p.speed || p.acceleration)) {
+      double want_v = p.speed + p.acceleration * (elapsed_uS - (window - 1) / 2.0 * gap_uS) / 1e6;
+      // levels are whole units, so allow one unit over the fit's span too
+      bool v_ok = fabs(vel - want_v) <= fabs(want_v) * 0.02 + 1e6 / m.span_uS;
+      bool a_ok = !p.acceleration || fabs(acc - p.acceleration) <= fabs(p.acceleration) * 0.02;
+      p.off_truth += !(v_ok && a_ok);
+    }
+    unsigned gap = (i + 1 >= slow_from ? 2 * gap_uS : gap_uS);
+    t += gap;
+    elapsed_uS += gap;
+  }
+}
+
+double ramp(double t_s, const profile_t& p) {
+  double y = 3000 + p.speed * t_s + p.acceleration * t_s * t_s / 2;
+  return (y < 1000 ? 1000 : y);
+}
+double noise(double, const profile_t&) {
+  return 3000 + rand() % 17 - 8;
+}
+double random_level(double, const profile_t&) {
+  return rand() % 4096;
+}
+
+int main() {
+  srand(3);
+  std::vector<profile_t> profiles;
+  unsigned failed = 0;
+  // one read per sweep, then ten times as often for fast presses (slow
+  // ones move less than a unit a read at that rate). each press stops
+  // before the ramp bottoms out.
+  struct {
+    unsigned gap_uS;
+    std::vector<double> speeds;
+    std::vector<double> accelerations;
+  } runs[] = {
+    {2560, {-1'000, -10'000, -40'000, -100'000}, {-1e6, -5e6, -2e7}},
+    {256, {-40'000, -100'000, -300'000}, {-1e8, -4e8}},
+  };
+  for (auto& r : runs) {
+    for (double speed : r.speeds) {
+      profile_t p = {"constant speed", speed, 0};
+      play(p, ramp, (unsigned)(1e6 * 1800 / -speed / r.gap_uS), r.gap_uS, 4);
+      profiles.push_back(p);
+    }
+    for (double acceleration : r.accelerations) {
+      profile_t p = {"constant acceleration", 0, acceleration};
+      play(p, ramp, (unsigned)(1e6 * sqrt(2 * 1800 / -acceleration) / r.gap_uS), r.gap_uS, 4);
+      profiles.push_back(p);
+    }
+  }
+  // the sweep slowing down part way through a press
+  for (double speed : {-1'000.0, -10'000.0}) {
+    profile_t p = {"sweep slows mid-press", speed, 0};
+    unsigned reads = (unsigned)(1e6 * 1800 / -speed / 2560 / 1.5);
+    play(p, ramp, reads, 2560, 4, reads / 2);
+    profiles.push_back(p);
+  }
+  {
+    profile_t p = {"noise +-8 every 32 uS", 0, 0};
+    play(p, noise, 100'000, 32, 0);
+    profiles.push_back(p);
+  }
+  {
+    profile_t p = {"random levels", 0, 0};
+    for (unsigned gap : {1u, 16u, 200u, 2560u, 60'000u}) {
+      play(p, random_level, 20'000, gap, gap / 4);
+    }
+    profiles.push_back(p);
+  }
+  for (auto& p : profiles) {
+    bool ok = !p.failed && !p.off_truth;
+    printf("%-22s %9.0f %11.0f: %6u reads, %u off the double fit, %u off the profile %s\n",
+      p.name, p.speed, p.acceleration, p.compares, p.failed, p.off_truth, (ok ? "ok" : "FAIL"));
+    failed += !ok;
+  }
+
+  const unsigned reads = 10'000'000;
+  motion_obj k;
+  int64_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < reads; ++i) {
+    k.push((int16_t)(3000 - (i & 1023)), i * 2560);
+    key_motion_t m = k.motion();
+    sink += motion_obj::velocity_per_s(m) + motion_obj::acceleration_per_s2(m);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double nS = std::chrono::duration<double, std::nano>(stop - start).count() / reads;
+  printf("one read: %.1f nS (%lld)\n", nS, (long long)(sink & 1));
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
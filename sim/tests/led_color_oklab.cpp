@@ -0,0 +1,110 @@
+// The fixed-point OKLCh to LED pipeline against the same steps
+// in double precision, and what converting one frame costs.
+//
+// The reference takes each color through OKLab with Bjorn Ottosson's
+// matrices at full precision: L C h to L a b, to L M S cubed, to linear
+// RGB clipped to 0 .. 1, then scaled by (brightness / 255) ^ 2.6 and
+// rounded to an LED level. Colors are every third L and C at 128 hues,
+// at brightness 255, 180 (the default) and 40.
+// Expected: no channel more than one level off the reference, and at
+// full brightness at least 90% of channels exactly on it (about 94%).
+// Then convert() is timed on frames of 140 random colors, and the time
+// per frame is printed (about 3 uS on an x86 host, against a frame
+// period of 16.7 mS) but not checked, as host timings are too noisy.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include "../src/utils.h"
+#include "../src/hexBoardHardware/color.h"
+
+struct channels_t {
+  double r, g, b;
+};
+
+channels_t reference(LED_oklch_t c) {
+  const double pi = 3.14159265358979323846;
+  double L = c.L / 255.0;
+  double C = c.C / 255.0 * 0.32;
+  double h = c.h * 2 * pi / 65536;
+  double a = C * cos(h);
+  double b = C * sin(h);
+  double l = L + 0.3963377774 * a + 0.2158037573 * b;
+  double m = L - 0.1055613458 * a - 0.0638541728 * b;
+  double s = L - 0.0894841775 * a - 1.2914855480 * b;
+  l = l * l * l;
+  m = m * m * m;
+  s = s * s * s;
+  auto clip = [](double x) {
+    return (x < 0 ? 0 : x > 1 ? 1 : x);
+  };
+  return {
+    clip(4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s),
+    clip(-1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s),
+    clip(-0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s)
+  };
+}
+
+LED_color_obj color;
+
+int main() {
+  unsigned failed = 0;
+  for (unsigned brightness : {255u, 180u, 40u}) {
+    color.set_brightness(brightness);
+    double scale = pow(brightness / 255.0, 2.6) * 255;
+    unsigned long long channels = 0, exact = 0;
+    int worst = 0;
+    for (unsigned L = 0; L <= 255; L += 3) {
+      for (unsigned C = 0; C <= 255; C += 3) {
+        for (unsigned h = 0; h < 65536; h += 512) {
+          LED_oklch_t c = {(uint8_t)L, (uint8_t)C, (uint16_t)h};
+          channels_t want = reference(c);
+          pixel_code got = color.code(c);
+          int diff[3] = {
+            (int)((got >> 16) & 0xFF) - (int)lround(want.r * scale),
+            (int)((got >> 8) & 0xFF) - (int)lround(want.g * scale),
+            (int)(got & 0xFF) - (int)lround(want.b * scale)
+          };
+          for (int d : diff) {
+            d = (d < 0 ? -d : d);
+            worst = (d > worst ? d : worst);
+            exact += !d;
+            ++channels;
+          }
+        }
+      }
+    }
+    double percent = 100.0 * exact / channels;
+    bool ok = (worst <= 1) && (brightness != 255 || percent >= 90);
+    printf("brightness %3u: %llu channels, %.1f%% exact, worst %d level%s %s\n",
+      brightness, channels, percent, worst, (worst == 1 ? "" : "s"), (ok ? "ok" : "FAIL"));
+    failed += !ok;
+  }
+
+  const unsigned frames = 20'000;
+  const unsigned count = 140;
+  static LED_oklch_t in[count];
+  static pixel_code out[count];
+  srand(5);
+  for (auto& c : in) {
+    c = {(uint8_t)(rand() & 0xFF), (uint8_t)(rand() & 0xFF), (uint16_t)(rand() & 0xFFFF)};
+  }
+  color.set_brightness(180);   // LED_default_brightness
+  unsigned long long sink = 0;
+  double best_uS = 1e9;
+  for (unsigned run = 0; run < 5; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned f = 0; f < frames; ++f) {
+      in[f % count].h += 97;
+      color.convert(in, out, count);
+      sink += out[f % count];
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double uS = std::chrono::duration<double, std::micro>(stop - start).count() / frames;
+    best_uS = (uS < best_uS ? uS : best_uS);
+  }
+  printf("one frame of %u: %.2f uS (%llu)\n", count, best_uS, sink & 1);
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
@@ -0,0 +1,72 @@
+// How many pixels the LED compositor works out per frame, and how long
+// a frame takes on the host.
+//
+// The firmware is set up as on the board, with one music key on every
+// LED, each with its own play and rest colors. LED_update_pixels() then
+// runs frame after frame: a first frame with every pixel unknown, idle
+// frames, frames where 4 keys change state, and frames after
+// invalidate(). Each is timed with the host clock.
+// Expected: every pixel composed on the first frame and after
+// invalidate(), none on an idle frame (and nothing sent), and exactly
+// the changed keys otherwise. The host time per frame of each kind is
+// printed but not checked, as host timings are too noisy to gate on.
+
+#include <stdio.h>
+#include <chrono>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+unsigned failed = 0;
+
+// runs frames of one kind, and checks the pixels composed per frame
+void run(const char* name, unsigned frames, unsigned want_per_frame, bool want_sent,
+  void (*before)(unsigned frame)) {
+  unsigned long long composed = LEDs.get_pixels_composed();
+  unsigned shown = LEDs.get_frames_shown();
+  double total_uS = 0;
+  for (unsigned f = 0; f < frames; ++f) {
+    before(f);
+    auto start = std::chrono::steady_clock::now();
+    LED_update_pixels();
+    auto stop = std::chrono::steady_clock::now();
+    total_uS += std::chrono::duration<double, std::micro>(stop - start).count();
+    sim_board.advance(LED_frame_period_in_uS);
+    strip.update();
+  }
+  unsigned long long per_frame = (LEDs.get_pixels_composed() - composed) / frames;
+  bool sent = (LEDs.get_frames_shown() - shown == frames);
+  bool ok = (per_frame == want_per_frame)
+    && (LEDs.get_pixels_composed() - composed == (unsigned long long)want_per_frame * frames)
+    && (sent == want_sent);
+  printf("%-16s %4u frames: %3llu pixels composed a frame, %s, %.2f uS a frame %s\n",
+    name, frames, per_frame, (sent ? "all sent" : "none sent"), total_uS / frames,
+    (ok ? "ok" : "FAIL"));
+  failed += !ok;
+}
+
+int main() {
+  sim_board.quiet = true;
+  setup();
+  setup1();
+  for (unsigned p = 0; p < ledCount; ++p) {
+    music_key_t k(button_t(p % 16, p / 16, 0, hex_t(p % 14, p / 14), p));
+    // whole LED steps, and dim enough to stay inside the power budget,
+    // so that no pixel dithers
+    k.LEDcodePlay = to_pixel_level(0x002000 + ((p & 7) << 16));
+    k.LEDcodeRest = to_pixel_level(0x000008 + (p & 7));
+    hexBoard.keys.emplace_back(k);
+  }
+  run("first frame", 1, ledCount, true, [](unsigned) {});
+  run("idle", 1000, 0, false, [](unsigned) {});
+  run("4 keys change", 1000, 4, true, [](unsigned f) {
+    for (unsigned i = 0; i < 4; ++i) {
+      auto& k = hexBoard.keys[(f * 37 + i * 11) % ledCount];
+      k.key_state = (k.key_state == button_off ? button_hold : button_off);
+    }
+  });
+  run("invalidate()", 1000, ledCount, true, [](unsigned) {
+    LEDs.invalidate();
+  });
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
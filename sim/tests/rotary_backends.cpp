@@ -0,0 +1,125 @@
+// The edge triggered rotary backend decodes the knob as the polled one
+// does, from far fewer interrupts.
+//
+// Two rotary_obj's read the same knob pins while the sim plays
+// sim/traces/rotary_gestures.trace: one polled every 768 uS by the task
+// manager, as the firmware does with rotary_edge_triggered false, and
+// one from pin change interrupts and its button alarm, as the firmware
+// does by default. Each of their interrupts is counted and timed. The
+// events are read every 2 S, as loop() logs them.
+// Expected: the same events (turns with their step and amount, clicks,
+// double clicks and long presses) from both, in every 2 S block but the
+// one with the quick detents, where the edge triggered one turns +1 all
+// 10 times and the polled one misses some steps but never turns -1.
+// The edge triggered one misses no steps, and takes under a tenth of
+// the polled one's interrupts (about 1 in 70). The host time spent in each is printed but not checked,
+// as host timings are too noisy.
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+constexpr bool hardware_task_profiling = false;
+#include "../src/hexBoardHardware/taskmgr.h"
+#include "../src/hexBoardHardware/rotary.h"
+
+const unsigned pinA = 20, pinB = 21, pinC = 24;
+const unsigned block_uS = 2'000'000;
+const unsigned quick_block = 4;     // the events logged at 10.0 S
+
+struct backend_t {
+  const char* name;
+  rotary_obj knob;
+  sim_timing_t irq;
+  std::vector<std::vector<std::string>> blocks;   // events read at the end of each 2 S
+  void timed(void (rotary_obj::*f)()) {
+    auto start = std::chrono::steady_clock::now();
+    (knob.*f)();
+    auto stop = std::chrono::steady_clock::now();
+    irq.add(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+  }
+  void drain() {
+    blocks.emplace_back();
+    rotary_event_t e;
+    while (knob.read_event(e)) {
+      std::string s = std::to_string(e.type) + " " + std::to_string(e.step);
+      if (e.type == rotary_turn) {
+        s += " by " + std::to_string(e.amount);
+      }
+      blocks.back().push_back(s);
+    }
+  }
+};
+
+backend_t polled = {"polled"};
+backend_t edge = {"edge triggered"};
+
+struct polled_task_obj {
+  void poll() {
+    polled.timed(&rotary_obj::poll);
+  }
+} polled_task;
+task_mgr_obj<16, task_t<768, polled_task, &polled_task_obj::poll>> task_mgr;
+
+void on_edge() {
+  edge.timed(&rotary_obj::on_edge);
+}
+void on_alarm() {
+  edge.timed(&rotary_obj::on_alarm);
+}
+
+int main() {
+  sim_board.quiet = true;
+  sim_board.attach_rotary(pinA, pinB, pinC);
+  if (!(sim_board.load_trace("sim/traces/rotary_gestures.trace"))) {
+    printf("could not read sim/traces/rotary_gestures.trace (run from the top of the repository)\nFAIL\n");
+    return 1;
+  }
+  polled.knob.setup(pinA, pinB, pinC);
+  edge.knob.setup(pinA, pinB, pinC);
+  edge.knob.begin_edge_triggered(1, on_edge, on_alarm);
+  task_mgr.init();
+  task_mgr.begin();
+  uint64_t end = sim_board.trace_end() + block_uS;
+  while (sim_board.now() < end) {
+    sim_board.advance(block_uS);
+    polled.drain();
+    edge.drain();
+  }
+
+  unsigned failed = 0;
+  for (unsigned b = 0; b < edge.blocks.size(); ++b) {
+    auto& p = polled.blocks[b];
+    auto& e = edge.blocks[b];
+    bool ok;
+    if (b == quick_block) {
+      unsigned turns = 0, wrong = 0;
+      for (auto& s : p) {
+        turns += (s == "1 1 by 1");
+        wrong += (s != "1 1 by 1");
+      }
+      ok = (e == std::vector<std::string>(10, "1 1 by 1")) && turns < 10 && !wrong;
+      printf("%4.1f S: quick detents: polled %u turns +1, %u others; edge triggered %zu events %s\n",
+        (b + 1) * block_uS / 1e6, turns, wrong, e.size(), (ok ? "ok" : "FAIL"));
+    } else {
+      ok = (p == e);
+      printf("%4.1f S: %zu events polled, %zu edge triggered, %s %s\n",
+        (b + 1) * block_uS / 1e6, p.size(), e.size(), (ok ? "the same" : "different"),
+        (ok ? "ok" : "FAIL"));
+    }
+    failed += !ok;
+  }
+  for (backend_t* k : {&polled, &edge}) {
+    printf("%-14s %6llu interrupts, %8.3f mS in them (host), missed steps %u\n",
+      k->name, (unsigned long long)k->irq.calls, k->irq.total_nS / 1e6, k->knob.get_missed_steps());
+  }
+  bool fewer = (edge.irq.calls * 10 < polled.irq.calls);
+  bool missed = (polled.knob.get_missed_steps() > 0 && !edge.knob.get_missed_steps());
+  if (!(fewer && missed)) {
+    printf("edge triggered should take under a tenth of the interrupts and miss no steps: FAIL\n");
+    ++failed;
+  }
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
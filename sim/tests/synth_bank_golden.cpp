@@ -0,0 +1,199 @@
+// The structure-of-arrays oscillator bank plays exactly what a
+// plain per-sample synth would, and how much faster it does it.
+//
+// The reference below is the V1 synth's shape: every sample, loop over
+// the voices and switch on the waveform inside the loop. It reads the
+// same band-limited tables the synth uses (built here from the same
+// shapes, see wavetable.h). Both play every waveform with 1, 5 and 16
+// voices from 55 Hz to 3.5 kHz, with the mod wheel moving and notes
+// stopping and starting along the way.
+// Expected: every sample identical. The time per voice-sample of both
+// is printed, with their ratio, but not checked: host timings are too
+// noisy to gate on.
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include "../src/hexBoardSynth/synth.h"
+
+const unsigned polyphony = 16;
+const unsigned block_size = 32;
+const unsigned sample_rate = 31250;
+
+// a per-sample synth to check the bank against
+struct reference_obj {
+  wavetable_obj wavetable;
+  wavetable_bands_t table;
+  unsigned waveform = 0;
+  unsigned mod = 0;
+  uint32_t increment[polyphony] = {};
+  uint32_t counter[polyphony] = {};
+  uint8_t band[polyphony] = {};
+  static constexpr uint8_t attenuation[17] = {64,24,17,14,12,11,10,9,8,8,8,7,7,7,6,6,6};
+  // the V1 hybrid shape: square below 220 Hz, saw 440-880 Hz, triangle
+  // above 1760 Hz, blended in between
+  static uint8_t hybrid(uint32_t f, uint8_t t) {
+    const uint32_t square = 220.0 / sample_rate * 4294967296.0 + 0.5;
+    const uint32_t saw_low = 440.0 / sample_rate * 4294967296.0 + 0.5;
+    const uint32_t saw_high = 880.0 / sample_rate * 4294967296.0 + 0.5;
+    const uint32_t triangle = 1760.0 / sample_rate * 4294967296.0 + 0.5;
+    uint8_t B = (f < square ? 128
+      : f < saw_low ? 128 + (127ull * (f - square)) / (saw_low - square)
+      : f < saw_high ? 255
+      : f < triangle ? 127 + (128ull * (triangle - f)) / (triangle - saw_high)
+      : 127);
+    uint8_t A = (f < saw_low ? 255 - B : 0);
+    uint8_t C = (f < saw_low ? 255 : B);
+    if (t <= A) {
+      return 0;
+    } else if (t < B) {
+      return ((t - A) * ((B - A > 1) ? 65535 / (B - A - 1) : 65535)) >> 8;
+    } else if (t <= C) {
+      return 255;
+    }
+    return ((256 - t) * (65535 / (256 - C))) >> 8;
+  }
+  void setup(unsigned wave) {
+    waveform = wave;
+    wavetable.setup();
+    uint8_t raw[256];
+    for (unsigned b = 0; b < wavetable_band_count; ++b) {
+      for (unsigned i = 0; i < 256; ++i) {
+        const uint8_t t = i;
+        switch (wave) {
+          case WAVEFORM_SINE:     raw[i] = sine[t];     break;
+          case WAVEFORM_STRINGS:  raw[i] = strings[t];  break;
+          case WAVEFORM_CLARINET: raw[i] = clarinet[t]; break;
+          case WAVEFORM_HYBRID:   raw[i] = hybrid(wavetable.band_center(b), t); break;
+          case WAVEFORM_TRIANGLE: raw[i] = ((t >> 7) ? 2 * (255 - t) : 2 * t); break;
+          default:                raw[i] = t;           break;
+        }
+      }
+      wavetable.band_limit(raw, wavetable.harmonics(b), table[b].data());
+    }
+  }
+  void set_increment(unsigned v, uint32_t inc) {
+    if (!(increment[v])) {
+      counter[v] = 0;
+    }
+    increment[v] = inc;
+    band[v] = wavetable.band_for(inc);
+  }
+  uint8_t next_sample() {
+    int32_t mix = 0;
+    unsigned voices = 0;
+    for (unsigned v = 0; v < polyphony; ++v) {
+      if (!(increment[v])) {
+        continue;
+      }
+      ++voices;
+      counter[v] += increment[v];
+      const int16_t* t = table[band[v]].data();
+      switch (waveform) {
+        case WAVEFORM_SQUARE: {
+          uint32_t offset = (255 - (128 - (mod >> 3) * 7)) << 24;
+          mix += t[counter[v] >> 24] - t[(counter[v] + offset) >> 24] + (int32_t)(offset >> 24);
+          break;
+        }
+        default:
+          mix += t[counter[v] >> 24];
+          break;
+      }
+    }
+    int32_t s = (mix * (int32_t)(attenuation[voices] * 127)) >> 13;
+    return (s < 0 ? 0 : s > 255 ? 255 : s);
+  }
+};
+
+synth_obj<polyphony, block_size> synth;
+reference_obj reference;
+
+uint32_t increment_of(unsigned v) {
+  return synth.increment_for(55.0 * exp2(v / 2.5));
+}
+
+// returns the number of samples that differ
+unsigned long long compare(unsigned wave, unsigned voices) {
+  // silence whatever the last run left playing, so every voice starts from phase 0
+  uint8_t out[block_size];
+  synth.setup(sample_rate);
+  synth.render_block(out);
+  synth.set_waveform(wave);
+  reference.setup(wave);
+  for (unsigned v = 0; v < polyphony; ++v) {
+    uint32_t inc = (v < voices ? increment_of(v) : 0);
+    synth.set_increment(v, inc);
+    reference.set_increment(v, 0);
+    reference.set_increment(v, inc);
+  }
+  unsigned long long differ = 0;
+  for (unsigned b = 0; b < 600; ++b) {
+    // every 50 blocks, move the mod wheel and stop or restart a voice
+    if (b % 50 == 25) {
+      unsigned v = (b / 50) % voices;
+      uint32_t inc = ((b / 50) & 1 ? 0 : increment_of(v + 3));
+      synth.set_increment(v, inc);
+      reference.set_increment(v, inc);
+      synth.set_mod(b % 128);
+      reference.mod = b % 128;
+    }
+    synth.render_block(out);
+    for (unsigned i = 0; i < block_size; ++i) {
+      differ += (out[i] != reference.next_sample());
+    }
+  }
+  return differ;
+}
+
+// nS per voice-sample, best of 5
+template <typename render_t>
+double time_per_voice_sample(render_t render) {
+  const unsigned blocks = 100'000;
+  double best = 1e9;
+  for (unsigned r = 0; r < 5; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned b = 0; b < blocks; ++b) {
+      render();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double nS = std::chrono::duration<double, std::nano>(stop - start).count() / (blocks * block_size * polyphony);
+    best = (nS < best ? nS : best);
+  }
+  return best;
+}
+
+int main() {
+  const char* names[] = {"sine", "strings", "clarinet", "hybrid", "square", "saw", "triangle"};
+  unsigned failed = 0;
+  for (unsigned w = 0; w < 7; ++w) {
+    for (unsigned voices : {1u, 5u, 16u}) {
+      unsigned long long differ = compare(w, voices);
+      printf("%-8s %2u voices: %llu samples differ\n", names[w], voices, differ);
+      failed += (differ != 0);
+    }
+  }
+  for (unsigned w : {(unsigned)WAVEFORM_SINE, (unsigned)WAVEFORM_SQUARE}) {
+    synth.setup(sample_rate);
+    synth.set_waveform(w);
+    reference.setup(w);
+    for (unsigned v = 0; v < polyphony; ++v) {
+      synth.set_increment(v, increment_of(v));
+      reference.set_increment(v, increment_of(v));
+    }
+    volatile uint8_t sink = 0;
+    double bank = time_per_voice_sample([&] {
+      uint8_t out[block_size];
+      synth.render_block(out);
+      sink = sink + out[0];
+    });
+    double per_sample = time_per_voice_sample([&] {
+      for (unsigned i = 0; i < block_size; ++i) {
+        sink = sink + reference.next_sample();
+      }
+    });
+    printf("%-8s 16 voices: bank %.2f nS, per-sample %.2f nS per voice-sample (%.2fx)\n",
+      names[w], bank, per_sample, per_sample / bank);
+  }
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
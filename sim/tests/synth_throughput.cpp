@@ -0,0 +1,67 @@
+// How many samples a second synth_fill_audio_buffer() renders with 1, 8
+// and 16 voices, and the headroom that leaves over the audio rate.
+//
+// The firmware is set up as on the board (hybrid waveform). For each
+// voice count, the voices play notes a whole tone apart from 110 Hz, and
+// then, over and over, 16 blocks are played out of the audio buffer
+// (untimed, as the audio task would) and synth_fill_audio_buffer()
+// fills it again, timed with the host clock, best of 5 runs.
+// Expected: every fill leaves the buffer with less than a block of room,
+// and the samples are not all the same (the voices play). The samples a
+// second and the headroom over actual_audio_sample_rate_in_Hz are printed
+// but not checked: host timings are too noisy to gate on, and the
+// RP2040 is far slower than the host, so only the ratios between voice
+// counts carry over.
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+int main() {
+  sim_board.quiet = true;
+  setup();
+  setup1();
+  unsigned failed = 0;
+  const unsigned fills = 20'000;
+  for (unsigned voices : {1u, 8u, 16u}) {
+    for (unsigned v = 0; v < synth_polyphony; ++v) {
+      synth.set_frequency(v, (v < voices ? 110.0 * exp2(v / 6.0) : 0));
+    }
+    double best = 0;
+    bool full = true;
+    unsigned lowest = 255, highest = 0;
+    for (unsigned run = 0; run < 5; ++run) {
+      unsigned long long samples = 0;
+      double seconds = 0;
+      for (unsigned f = 0; f < fills; ++f) {
+        while (audioOut.roomToWrite() < synth_block_size * 16) {
+          audioOut.poll();
+        }
+        unsigned room = audioOut.roomToWrite();
+        auto start = std::chrono::steady_clock::now();
+        synth_fill_audio_buffer();
+        auto stop = std::chrono::steady_clock::now();
+        seconds += std::chrono::duration<double>(stop - start).count();
+        samples += room - audioOut.roomToWrite();
+        full = full && (audioOut.roomToWrite() < synth_block_size);
+      }
+      best = (samples / seconds > best ? samples / seconds : best);
+    }
+    // the voices play: the samples of 8 blocks are not all the same
+    for (unsigned i = 0; i < synth_block_size * 8; ++i) {
+      audioOut.poll();
+      unsigned s = sim_board.pwm_level[piezoPin];
+      lowest = (s < lowest ? s : lowest);
+      highest = (s > highest ? s : highest);
+    }
+    bool ok = full && highest > lowest;
+    printf("%2u voices: %.2fM samples a second (host), %.0fx the %u Hz audio rate %s\n",
+      voices, best / 1e6, best / actual_audio_sample_rate_in_Hz, actual_audio_sample_rate_in_Hz,
+      (ok ? "ok" : "FAIL"));
+    failed += !ok;
+  }
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
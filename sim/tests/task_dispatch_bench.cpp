@@ -0,0 +1,101 @@
+// What the compile-time task table saves per interrupt.
+//
+// Two task managers with the same three tasks (every 16, 32 and 768 uS):
+// one calls the poll routines directly through the table, the other
+// calls them through std::function, as the task list did before. Each
+// dispatches 10'000'000 back-to-back interrupts, best of 5 runs.
+// Expected: the same calls in the same order either way. The time per
+// interrupt is printed for both, and their ratio, but not checked: host
+// timings are too noisy to gate on (the table is about 14 nS against
+// 17 nS on an x86 laptop).
+
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include "Arduino.h"
+constexpr bool hardware_task_profiling = false;
+#include "../src/hexBoardHardware/taskmgr.h"
+
+// the first calls each manager makes, by task, to compare their order
+const unsigned order_length = 4096;
+struct order_t {
+  char task[order_length];
+  unsigned count = 0;
+};
+order_t direct_order, erased_order;
+
+struct counter_obj {
+  volatile unsigned calls = 0;
+  order_t& order;
+  char name;
+  counter_obj(order_t& o, char n) : order(o), name(n) {}
+  void poll() {
+    ++calls;
+    if (order.count < order_length) {
+      order.task[order.count++] = name;
+    }
+  }
+};
+// a task called through std::function, as task_obj::exec_on_trigger was
+struct erased_obj {
+  std::function<void()> exec_on_trigger;
+  void poll() {
+    exec_on_trigger();
+  }
+};
+
+counter_obj direct_a(direct_order, 'a'), direct_b(direct_order, 'b'), direct_c(direct_order, 'c');
+counter_obj erased_a(erased_order, 'a'), erased_b(erased_order, 'b'), erased_c(erased_order, 'c');
+erased_obj call_a, call_b, call_c;
+
+task_mgr_obj<16,
+  task_t<32,  direct_a, &counter_obj::poll>,
+  task_t<768, direct_b, &counter_obj::poll>,
+  task_t<16,  direct_c, &counter_obj::poll>
+> direct_mgr;
+task_mgr_obj<16,
+  task_t<32,  call_a, &erased_obj::poll>,
+  task_t<768, call_b, &erased_obj::poll>,
+  task_t<16,  call_c, &erased_obj::poll>
+> erased_mgr;
+
+const unsigned interrupts = 10'000'000;
+const unsigned repeats = 5;
+
+template <typename mgr_t>
+double best_nS_per_interrupt(mgr_t& mgr) {
+  double best = 1e9;
+  for (unsigned r = 0; r < repeats; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < interrupts; ++i) {
+      mgr.dispatch();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double nS = std::chrono::duration<double, std::nano>(stop - start).count() / interrupts;
+    best = (nS < best ? nS : best);
+  }
+  return best;
+}
+
+int main() {
+  call_a.exec_on_trigger = std::bind(&counter_obj::poll, &erased_a);
+  call_b.exec_on_trigger = std::bind(&counter_obj::poll, &erased_b);
+  call_c.exec_on_trigger = std::bind(&counter_obj::poll, &erased_c);
+  // the alarm is never serviced; dispatch() is called directly
+  direct_mgr.init();
+  erased_mgr.init();
+  double erased = best_nS_per_interrupt(erased_mgr);
+  double direct = best_nS_per_interrupt(direct_mgr);
+  printf("std::function: %.2f nS per interrupt, calls %u %u %u\n",
+    erased, erased_a.calls, erased_b.calls, erased_c.calls);
+  printf("task table:    %.2f nS per interrupt, calls %u %u %u\n",
+    direct, direct_a.calls, direct_b.calls, direct_c.calls);
+  printf("table / std::function: %.2f\n", direct / erased);
+  bool same = (direct_a.calls == erased_a.calls) && (direct_b.calls == erased_b.calls)
+    && (direct_c.calls == erased_c.calls) && direct_c.calls;
+  bool in_order = (direct_order.count == order_length) && (erased_order.count == order_length)
+    && !memcmp(direct_order.task, erased_order.task, order_length);
+  printf("same calls: %s, same order: %s\n", (same ? "yes" : "no"), (in_order ? "yes" : "no"));
+  printf("%s\n", (same && in_order ? "ok" : "FAIL"));
+  return (same && in_order ? 0 : 1);
+}
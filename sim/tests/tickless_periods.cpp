@@ -0,0 +1,81 @@
+// The tickless task manager still runs every task at its period.
+//
+// Three tasks (every 32, 80 and 768 uS, on a 16 uS tick) run for one
+// virtual second, once ticking and once tickless. Expected, in both
+// modes: each task runs 1'000'000 / period times, every run exactly one
+// period after the last, none late or missed. Tickless takes fewer
+// interrupts: one per distinct due time (37'500; the 768 uS task always
+// shares one with the 32 uS task) instead of one per tick (62'500).
+// This is a made-up task set: the firmware's own has the keyboard task
+// every tick, so it gains nothing from tickless and runs ticking.
+
+#include <stdio.h>
+#include "Arduino.h"
+constexpr bool hardware_task_profiling = false;
+#include "../src/hexBoardHardware/taskmgr.h"
+
+const unsigned run_uS = 1'000'000;
+
+// counts its runs and checks the time between them
+template <int tag>
+struct probe_obj {
+  unsigned period = 0;
+  unsigned runs = 0;
+  unsigned off_period = 0;
+  uint64_t last = 0;
+  void poll() {
+    uint64_t now = sim_board.now();
+    if (runs && now - last != period) {
+      ++off_period;
+    }
+    last = now;
+    ++runs;
+  }
+};
+
+template <int mode>
+struct run_obj {
+  static inline probe_obj<mode> a, b, c;
+  static inline task_mgr_obj<16,
+    task_t<32, a, &probe_obj<mode>::poll>,
+    task_t<80, b, &probe_obj<mode>::poll>,
+    task_t<768, c, &probe_obj<mode>::poll>
+  > mgr;
+  static inline uint64_t interrupts = 0;
+  // returns the number of failures
+  static unsigned run(bool tickless) {
+    a.period = 32;
+    b.period = 80;
+    c.period = 768;
+    uint64_t irqs = sim_board.irq_timing.calls;
+    mgr.init(tickless);
+    mgr.begin();
+    sim_board.advance(run_uS);
+    irq_set_enabled(0, false);    // hand the alarm to the next run
+    interrupts = sim_board.irq_timing.calls - irqs;
+    printf("%s: %llu interrupts\n", (tickless ? "tickless" : "ticking"), (unsigned long long)interrupts);
+    unsigned failed = 0;
+    probe_obj<mode>* probes[] = {&a, &b, &c};
+    for (unsigned i = 0; i < 3; ++i) {
+      auto& p = *probes[i];
+      unsigned want = run_uS / p.period;
+      bool ok = (p.runs + 1 >= want && p.runs <= want) && !p.off_period
+        && !mgr.get_late(i) && !mgr.get_missed(i);
+      printf("  every %3u uS: runs %u (want %u), off period %u, late %u, missed %u %s\n",
+        p.period, p.runs, want, p.off_period, mgr.get_late(i), mgr.get_missed(i), (ok ? "ok" : "FAIL"));
+      failed += !ok;
+    }
+    return failed;
+  }
+};
+
+int main() {
+  unsigned failed = run_obj<0>::run(false);
+  failed += run_obj<1>::run(true);
+  if (run_obj<1>::interrupts * 3 > run_obj<0>::interrupts * 2) {
+    printf("tickless should take well under the ticking interrupts: FAIL\n");
+    ++failed;
+  }
+  printf(failed ? "FAIL\n" : "ok\n");
+  return (failed ? 1 : 0);
+}
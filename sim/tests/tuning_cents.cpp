@@ -0,0 +1,50 @@
+// The synth plays microtonal tunings to within a thousandth
+// of a cent.
+//
+// For the 31-EDO, Bohlen-Pierce and Carlos Alpha scales in library.h,
+// every note from 20 Hz to 8 kHz is looked up in the synth's increment
+// table, as synth_note_on() does, and the pitch that increment plays at
+// the audio sample rate is compared with the tuning. For comparison it
+// also prints the error of the V1 16-bit increments.
+// Expected: the worst error under 0.001 cents on every scale (it is
+// about 0.0003), where the 16-bit increments were 9 to 15 cents off.
+
+#include <stdio.h>
+#include <math.h>
+#include "Arduino.h"
+#include "../HexBoardv1_2.ino"
+
+// returns true if the scale is within the limit
+bool check(const char* name, const Tunings::Scale& scale) {
+  Tunings::Tuning t(scale, kbm_A440_root_C, false);
+  synth_setup(t);
+  const double rate = actual_audio_sample_rate_in_Hz;
+  double worst = 0;
+  double worst_16_bit = 0;
+  unsigned notes = 0;
+  for (int i = 0; i < Tunings::Tuning::N; ++i) {
+    double f = t.ptable[i] * Tunings::MIDI_0_FREQ;
+    if (f < 20 || f > 8000) {
+      continue;
+    }
+    ++notes;
+    double played = synth_increment_for_note(i - 256) * rate / 4294967296.0;
+    double played_16_bit = lround(f * 65536.0 / rate) * rate / 65536.0;
+    worst = fmax(worst, fabs(1200 * log2(played / f)));
+    worst_16_bit = fmax(worst_16_bit, fabs(1200 * log2(played_16_bit / f)));
+  }
+  bool ok = notes && (worst < 0.001);
+  printf("%-14s %3u notes: worst error %.5f cents (16-bit: %.2f cents) %s\n",
+    name, notes, worst, worst_16_bit, (ok ? "ok" : "FAIL"));
+  return ok;
+}
+
+int main() {
+  sim_board.quiet = true;
+  unsigned failed = 0;
+  failed += !check("31-EDO", scale_31_edo);
+  failed += !check("Bohlen-Pierce", bohlen_pierce);
+  failed += !check("Carlos Alpha", carlos_alpha);
+  printf("%s\n", (failed ? "FAIL" : "ok"));
+  return (failed ? 1 : 0);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <type_traits>
 
 // Hardware pin constants
 // If you rewire the HexBoard then change these pin values
@@ -11,15 +12,57 @@ const int default_analog_calibration_up = 480;
 const int default_analog_calibration_down = 280;
 const unsigned keyboard_pin_reset_period_in_uS = 16;
 const unsigned keyboard_reads_to_retain        = 10;
+// settings are in reads of the key, one per sweep of the grid (hot
+// re-reads of analog keys do not count), so 2 reads is 2.5 to 5 mS
+#include "hexBoardHardware/debounce.h"
+const unsigned keyboard_debounce_algorithm     = debounce_asymmetric;
+const unsigned keyboard_debounce_press_reads   = 2;
+const unsigned keyboard_debounce_release_reads = 2;
+// analog keys: reads per velocity fit, and the speed (resolution units
+// per second) that gives MIDI velocity 127. shape: 100 = linear
+const unsigned keyboard_velocity_window        = 8;
+const unsigned keyboard_velocity_full_speed    = 40'000;
+const unsigned keyboard_velocity_shape_percent = 100;
+// analog keys: reads of keys in play after each sweep read. a full sweep
+// then takes at most keys * (1 + this) polls: 160 * 2 * 16 uS = 5.12 mS.
+// a key is in play while down, or for the linger after it moved by
+// at least the threshold (resolution units) between two reads
+const unsigned keyboard_hot_reads_per_sweep_read = 1;
+const unsigned keyboard_hot_linger_sweeps        = 20;
+const int      keyboard_hot_threshold            = 6;
+// room for colPins.size() << muxPins.size() keys
+const unsigned keyboard_key_capacity           = 160;
 #include "hexBoardHardware/keys.h"
-pinGrid_obj pinGrid;
+pinGrid_obj<keyboard_key_capacity, keyboard_reads_to_retain, keyboard_velocity_window> pinGrid;
+
+// analog keys calibrate themselves while they are scanned, and the
+// profiles are kept in flash so the keys are right from the first read
+// after a restart (see calibrationFile.h). without a saved profile, the
+// first sweeps after boot take each key's rest level as read.
+const char* keyboard_calibration_path = "/key_calibration.bin";
+const unsigned keyboard_calibration_warm_up_sweeps     = 32;
+const unsigned keyboard_calibration_save_period_in_mS  = 600'000;
+const unsigned keyboard_calibration_retry_period_in_mS = 60'000;  // after a failed save
+const int keyboard_calibration_save_threshold          = 4;  // resolution units
+#include "hexBoardHardware/calibrationFile.h"
+key_calibration_file_obj<decltype(pinGrid), keyboard_key_capacity> keyCalibrationFile;
 
 const unsigned rotaryPinA = 20;
 const unsigned rotaryPinB = 21;
 const unsigned rotaryPinC = 24;
 const unsigned rotary_pin_fire_period_in_uS = 768;
+// true: decode the knob from pin change interrupts instead of polling it
+// every rotary_pin_fire_period_in_uS. the button timers then use this alarm
+constexpr bool rotary_edge_triggered = true;
+const unsigned rotary_alarm_ID = 1;
 #include "hexBoardHardware/rotary.h"
 rotary_obj rotary;
+void rotary_on_edge() {
+  rotary.on_edge();
+}
+void rotary_on_alarm() {
+  rotary.on_alarm();
+}
 
 const unsigned piezoPin = 23;
 const unsigned audioJackPin = 25;
@@ -32,7 +75,24 @@ const unsigned ledPin = 22;
 const unsigned OLED_sdaPin = 16;
 const unsigned OLED_sclPin = 17;
 const unsigned target_LED_frame_rate_in_Hz = 60;
-// #include "hexBoardHardware/LED.h"
+constexpr unsigned LED_frame_period_in_uS = 1'000'000 / target_LED_frame_rate_in_Hz;
+#include "hexBoardHardware/LED.h"
+LED_strip_obj strip;
+#include "hexBoardHardware/compositor.h"
+LED_compositor_obj LEDs;
+// for colors given in OKLCh (see color.h). brightness 0 - 255; 180 was the V1 default
+const uint8_t LED_default_brightness = 180;
+// show colors between the LEDs' steps by flickering between the two nearest
+// at the frame rate (see LED.h). keeps dim colors apart at low brightness
+constexpr bool LED_temporal_dithering = true;
+// the most current the LEDs may draw: what's left of USB's 500 mA after
+// the rest of the board. a WS2812B draws about 1 mA idle, and about 20 mA
+// per channel at full. frames over the budget are dimmed to fit (see compositor.h)
+const unsigned LED_power_budget_in_mA = 400;
+const unsigned LED_idle_mA = 1;
+const unsigned LED_channel_full_mA = 20;
+// no LED_color_obj is made until a layout gives its colors in OKLCh
+#include "hexBoardHardware/color.h"
 
 constexpr unsigned target_audio_sample_halfperiod_in_uS = 500'000 / target_audio_sample_rate_in_Hz;
 constexpr unsigned hardware_tick_period_in_uS = 
@@ -40,7 +100,48 @@ constexpr unsigned hardware_tick_period_in_uS =
   ? target_audio_sample_halfperiod_in_uS : keyboard_pin_reset_period_in_uS ); 
 constexpr unsigned actual_audio_sample_period_in_uS = 2 * hardware_tick_period_in_uS;
 constexpr unsigned actual_audio_sample_rate_in_Hz  = 1'000'000 / actual_audio_sample_period_in_uS;
+// true: set the timer alarm for the next task that is due, instead of every tick.
+// off, as the keyboard task is due every tick, so tickless would save nothing
+const bool hardware_tickless_timer = false;
+// time each interrupt may spend running due tasks before the rest carry over
+constexpr unsigned hardware_irq_budget_in_uS = hardware_tick_period_in_uS;
+// false: run due tasks in the order listed below. true: earliest deadline first
+const bool hardware_dispatch_by_deadline = false;
+// true: time every task run and keep per-task histograms (see taskmgr.h)
+constexpr bool hardware_task_profiling = false;
 #include "hexBoardHardware/taskmgr.h"
+template <typename... rotary_task>
+using hardware_task_mgr = task_mgr_obj<hardware_tick_period_in_uS,
+  // audio sample update - highest priority (stable period needed)
+  task_t<actual_audio_sample_period_in_uS, audioOut, &audioOut_obj::poll>,
+  // rotary knob, unless edge triggered - 2nd highest priority (input drop risk)
+  rotary_task...,
+  // keyboard - lowest priority (timing requirements are loose)
+  task_t<keyboard_pin_reset_period_in_uS,  pinGrid,  &decltype(pinGrid)::poll>
+>;
+std::conditional_t<rotary_edge_triggered,
+  hardware_task_mgr<>,
+  hardware_task_mgr<task_t<rotary_pin_fire_period_in_uS, rotary, &rotary_obj::poll>>
+> task_mgr;
+
+// the key grid; analog says which column pins are analog
+void keyboard_setup(const std::vector<bool>& analog) {
+  //  first T/F: are the column pins analog?
+  //  second T/F: iterate thru the multiplex pins before the column pins?
+  pinGrid.setup(colPins, analog, muxPins, true,
+    default_analog_calibration_up, default_analog_calibration_down
+  );
+  pinGrid.set_debounce(keyboard_debounce_algorithm,
+    keyboard_debounce_press_reads, keyboard_debounce_release_reads);
+  pinGrid.set_velocity_curve(keyboard_velocity_full_speed, keyboard_velocity_shape_percent);
+  pinGrid.set_scan_schedule(keyboard_hot_reads_per_sweep_read,
+    keyboard_hot_linger_sweeps, keyboard_hot_threshold);
+  keyCalibrationFile.setup(pinGrid, keyboard_calibration_path,
+    keyboard_calibration_save_period_in_mS, keyboard_calibration_retry_period_in_mS,
+    keyboard_calibration_save_threshold);
+  bool calibrated = keyCalibrationFile.load();
+  pinGrid.set_auto_calibration(true, (calibrated ? 0 : keyboard_calibration_warm_up_sweeps));
+}
 
 // global, call this on setup() i.e. the 1st core
 void hardware_setup() {
@@ -52,22 +153,22 @@ void hardware_setup() {
   audioOut.set_pin(piezoPin, true);
   //  rotary should define a pin A and B. pin C is the center click button if it exists
   rotary.setup(rotaryPinA,rotaryPinB,rotaryPinC);
-  //  first T/F: are the column pins analog?
-  //  second T/F: iterate thru the multiplex pins before the column pins?
-  pinGrid.setup(colPins, analogPins, muxPins, true, keyboard_reads_to_retain, 
-    default_analog_calibration_up, default_analog_calibration_down
-  );
+  keyboard_setup(analogPins);
+  // the LEDs are sent from this core, by PIO and DMA (see LED.h)
+  strip.setup(ledPin, ledCount);
+  LEDs.setup(strip);
+  LEDs.set_power_budget(LED_power_budget_in_mA, LED_idle_mA, LED_channel_full_mA);
+  strip.set_dithering(LED_temporal_dithering);
 }
 
 // global, call this on setup1() i.e. the 2nd core
 void hardware_start_background_process() {
-    task_mgr.init(hardware_tick_period_in_uS);
-    // audio sample update - highest priority (stable period needed)
-    task_mgr.add_task(actual_audio_sample_period_in_uS, std::bind(&audioOut_obj::poll, &audioOut));
-    // rotary knob - 2nd highest priority (input drop risk)
-    task_mgr.add_task(rotary_pin_fire_period_in_uS,     std::bind(&rotary_obj::poll,   &rotary));
-    // keyboard - lowest priority (timing requirements are loose)
-    task_mgr.add_task(keyboard_pin_reset_period_in_uS,  std::bind(&pinGrid_obj::poll,  &pinGrid));
+    // the task list itself is fixed above, where task_mgr is declared
+    task_mgr.init(hardware_tickless_timer, hardware_irq_budget_in_uS, hardware_dispatch_by_deadline);
     // start receiving input and processing audio output
     task_mgr.begin();
+    // the knob's interrupts go to this core too, so its events have one writer
+    if constexpr (rotary_edge_triggered) {
+      rotary.begin_edge_triggered(rotary_alarm_ID, rotary_on_edge, rotary_on_alarm);
+    }
 }
\ No newline at end of file
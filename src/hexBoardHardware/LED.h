@@ -0,0 +1,230 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <vector>
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "hardware/timer.h"
+
+/*
+  LED output to the WS2812 ("NeoPixel") strip,
+  without holding up the processor.
+
+  The NeoPixel library bit-bangs the strip with
+  interrupts off: 24 bits at 1.25 uS each per LED,
+  so 4.2 mS for 140 LEDs, in which the audio and
+  key interrupts cannot run. Here a PIO state
+  machine makes the waveform and a DMA channel
+  feeds it, so show() only has to pack the colors
+  and start the transfer.
+
+  There are two transfer buffers. show() packs the
+  frame into the one not being sent, so the next
+  frame can be composed and packed while the last
+  one goes out. Only pixels that changed since that
+  buffer was last packed are packed again. If the strip is still busy (the
+  transfer, then the quiet time the LEDs need to
+  latch) the packed frame waits, and update()
+  starts it once the strip is free. A frame that
+  is shown again before it went out is replaced by
+  the newer one, and counted.
+
+  Pixels are held as pixel_levels, finer than the
+  LEDs' 256 steps. With dithering on, each channel
+  keeps the part of a step it could not show, and
+  adds it in next frame (error diffusion in time):
+  a level of 2.25 shows as 2, 2, 2, 3, 2, 2, 2, 3...
+  which averages out to 2.25 at the frame rate.
+  This keeps dim colors that differ by less than a
+  step apart. Such pixels are packed again every
+  frame, and is_dithering() tells the compositor
+  to keep sending frames. It costs an add and a
+  shift per channel. With dithering off, levels
+  are rounded to the nearest step.
+
+  set_scale() dims the whole frame by a factor in
+  1/256ths as it is packed (the compositor's power
+  limit), without touching the colors as set.
+
+  All of this runs on one core (core 0); nothing
+  here is touched from an interrupt.
+*/
+
+const uint16_t LED_full_scale = 256;   // set_scale(): no dimming
+
+class LED_strip_obj {
+  private:
+    // ws2812.pio from the pico-examples, side-set 1 pin:
+    //   0: out x, 1     side 0 [2]
+    //   1: jmp !x, 3    side 1 [1]
+    //   2: jmp 0        side 1 [4]
+    //   3: nop          side 0 [4]
+    // a 1 is high for 7 cycles of 10, a 0 for 3
+    static constexpr uint16_t ws2812_program[] = {0x6221, 0x1123, 0x1400, 0xa442};
+    static constexpr unsigned cycles_per_bit = 10;
+    static constexpr unsigned bit_rate_in_Hz = 800'000;
+    static constexpr unsigned bits_per_LED = 24;
+    // low time for the LEDs to take the frame (WS2812B: over 280 uS)
+    static constexpr unsigned latch_uS = 300;
+    std::vector<pixel_level> _pixels;                // as set
+    std::vector<std::array<uint8_t, 3>> _error;      // dithering: the part of a step left over
+    bool _dither = false;
+    unsigned _fine = 0;                              // pixels that are between two steps
+    uint16_t _scale = LED_full_scale;                // of every level, in 1/256ths
+    std::array<std::vector<uint32_t>, 2> _packed;    // GRB in the top 24 bits, as sent
+    std::vector<uint8_t> _stale;                     // bit n: not yet packed into buffer n
+    unsigned _sending = 0;     // the buffer the DMA reads from
+    bool _pending = false;     // the other buffer holds a frame to send
+    PIO _pio = pio0;
+    unsigned _sm = 0;
+    int _dma = -1;
+    uint64_t _freeAt = 0;      // end of the last transfer plus the latch time
+    unsigned _sent = 0;
+    unsigned _replaced = 0;
+    static bool is_fine(const pixel_level& p) {
+      return ((p.r | p.g | p.b) & 0xFF);
+    }
+    uint16_t scaled(uint16_t v) {
+      return ((uint32_t)v * _scale) >> 8;
+    }
+    static uint8_t round_level(uint16_t v) {
+      return (v >= 0xFF80 ? 0xFF : (v + 0x80) >> 8);
+    }
+    uint8_t dither_level(uint16_t v, uint8_t& error) {
+      uint32_t sum = v + error;
+      error = sum & 0xFF;
+      return (sum > 0xFFFF ? 0xFF : sum >> 8);
+    }
+    void start() {
+      auto& buffer = _packed[_sending ^ 1];
+      dma_channel_transfer_from_buffer_now(_dma, buffer.data(), buffer.size());
+      _sending ^= 1;
+      _pending = false;
+      _freeAt = time_us_64() + frame_time_in_uS();
+      ++_sent;
+    }
+  public:
+    void setup(unsigned pin, unsigned count) {
+      _pixels.assign(count, pixel_level());
+      for (auto& b : _packed) {
+        b.assign(count, 0);
+      }
+      _stale.assign(count, 0);
+      // start each pixel's leftovers at a different point, so that
+      // pixels on the same level do not all step up on the same frame
+      _error.resize(count);
+      for (unsigned i = 0; i < count; ++i) {
+        for (unsigned c = 0; c < 3; ++c) {
+          _error[i][c] = (i * 167 + c * 85) & 0xFF;
+        }
+      }
+      _fine = 0;
+      static const pio_program_t program = {ws2812_program, 4, -1};
+      unsigned offset = pio_add_program(_pio, &program);
+      _sm = pio_claim_unused_sm(_pio, true);
+      pio_gpio_init(_pio, pin);
+      pio_sm_set_consecutive_pindirs(_pio, _sm, pin, 1, true);
+      pio_sm_config c = pio_get_default_sm_config();
+      sm_config_set_wrap(&c, offset, offset + 3);
+      sm_config_set_sideset(&c, 1, false, false);
+      sm_config_set_sideset_pins(&c, pin);
+      sm_config_set_out_shift(&c, false, true, bits_per_LED);  // msb first, autopull
+      sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+      sm_config_set_clkdiv(&c, clock_get_hz(clk_sys) / (float)(bit_rate_in_Hz * cycles_per_bit));
+      pio_sm_init(_pio, _sm, offset, &c);
+      pio_sm_set_enabled(_pio, _sm, true);
+      _dma = dma_claim_unused_channel(true);
+      dma_channel_config d = dma_channel_get_default_config(_dma);
+      channel_config_set_transfer_data_size(&d, DMA_SIZE_32);
+      channel_config_set_read_increment(&d, true);
+      channel_config_set_write_increment(&d, false);
+      channel_config_set_dreq(&d, pio_get_dreq(_pio, _sm, true));
+      dma_channel_configure(_dma, &d, &_pio->txf[_sm], nullptr, count, false);
+      // the LEDs keep their colors through a reset, so start from all off
+      show();
+    }
+    unsigned count() {
+      return _pixels.size();
+    }
+    void set_dithering(bool on) {
+      _dither = on;
+      for (auto& s : _stale) {
+        s = 0b11;
+      }
+    }
+    bool is_dithering() {
+      return _dither && (_fine || _scale != LED_full_scale);
+    }
+    void set_scale(uint16_t scale) {
+      scale = (scale > LED_full_scale ? LED_full_scale : scale);
+      if (scale != _scale) {
+        _scale = scale;
+        for (auto& s : _stale) {
+          s = 0b11;
+        }
+      }
+    }
+    uint16_t get_scale() {
+      return _scale;
+    }
+    void set_pixel(unsigned i, pixel_level p) {
+      if (i < _pixels.size() && _pixels[i] != p) {
+        _fine += is_fine(p);
+        _fine -= is_fine(_pixels[i]);
+        _pixels[i] = p;
+        _stale[i] = 0b11;
+      }
+    }
+    void set_pixel(unsigned i, pixel_code c) {
+      set_pixel(i, to_pixel_level(c));
+    }
+    pixel_level get_pixel(unsigned i) {
+      return (i < _pixels.size() ? _pixels[i] : pixel_level());
+    }
+    // pack the frame and send it as soon as the strip is free. never waits
+    void show() {
+      unsigned n = _sending ^ 1;
+      auto& buffer = _packed[n];
+      for (unsigned i = 0; i < _pixels.size(); ++i) {
+        pixel_level p = _pixels[i];
+        if (_scale != LED_full_scale) {
+          p = {scaled(p.r), scaled(p.g), scaled(p.b)};
+        }
+        if (_dither && is_fine(p)) {
+          auto& e = _error[i];
+          buffer[i] = ((uint32_t)dither_level(p.g, e[1]) << 24)
+            | ((uint32_t)dither_level(p.r, e[0]) << 16) | ((uint32_t)dither_level(p.b, e[2]) << 8);
+          _stale[i] = 0b11;   // the other buffer will need this pixel's next step
+        } else if (_stale[i] & (1u << n)) {
+          buffer[i] = ((uint32_t)round_level(p.g) << 24)
+            | ((uint32_t)round_level(p.r) << 16) | ((uint32_t)round_level(p.b) << 8);
+        }
+        _stale[i] &= ~(1u << n);
+      }
+      if (_pending) {
+        ++_replaced;
+      }
+      _pending = true;
+      update();
+    }
+    // call often: starts a frame that was waiting for the strip
+    void update() {
+      if (_pending && is_free()) {
+        start();
+      }
+    }
+    bool is_free() {
+      return (_dma >= 0) && !(dma_channel_is_busy(_dma)) && (time_us_64() >= _freeAt);
+    }
+    // time on the wire for one frame, plus the latch
+    unsigned frame_time_in_uS() {
+      return _pixels.size() * bits_per_LED * 1'000'000 / bit_rate_in_Hz + latch_uS;
+    }
+    unsigned get_frames_sent() {
+      return _sent;
+    }
+    unsigned get_frames_replaced() {
+      return _replaced;
+    }
+};
@@ -1,33 +1,9 @@
 #pragma once
 #include <vector>
 #include <algorithm>
-
-struct ringBuffer_obj {
-  // stores a vector of bytes
-  std::vector<unsigned char> buffer;
-  unsigned indexRead;
-  unsigned indexWrite;
-  unsigned capacity;
-  unsigned spaceLeft;
-  void init(unsigned capacity) {
-    this->capacity = capacity;
-    this->spaceLeft = capacity;
-    this->indexRead = 0;
-    this->indexWrite = 0;
-    buffer.resize(capacity);
-  }
-  void write(unsigned char element) {
-    buffer[indexWrite] = element;
-    indexWrite = (indexWrite + 1) % capacity;
-    --spaceLeft;
-  }
-  unsigned char read() {
-    unsigned char element = buffer[indexRead];
-    indexRead = (indexRead + 1) % capacity;
-    ++spaceLeft;
-    return element;
-  }
-};
+#include <array>
+#include <atomic>
+#include "ringBuffer.h"
 
 #include <Wire.h>
 #include "hardware/pwm.h"       // library of code to access the processor's built in pulse wave modulation features
@@ -35,7 +11,7 @@ struct ringBuffer_obj {
 class audioOut_obj {
   private:
     std::vector<unsigned> pwmPins;
-    ringBuffer_obj buffer;
+    ringBuffer_obj<1024> buffer;
     unsigned sample_rate;
     void enable(unsigned pin) {
       auto n = std::find(pwmPins.begin(), pwmPins.end(), pin);
@@ -57,7 +33,7 @@ class audioOut_obj {
   public:
     void setup(unsigned arg_sample_rate) {
       sample_rate = arg_sample_rate;
-      buffer.init(1024);
+      buffer.init();
     }
     void set_pin(unsigned pin, bool activate) {
       if (activate) {
@@ -68,19 +44,21 @@ class audioOut_obj {
     }
     void poll() {
       unsigned char lvl = 0;
-      if (buffer.capacity - buffer.spaceLeft) {
-        lvl = buffer.read();
-      }
+      buffer.read(lvl);
       for (auto& pin : pwmPins) {
         pwm_set_gpio_level(pin, lvl);      
       }
     }
     unsigned roomToWrite() {
-      return buffer.spaceLeft;
+      return buffer.spaceLeft();
     }
     void write(unsigned char element) {
       buffer.write(element);
     }
+    // hand over a block of samples in one go; returns how many fit
+    unsigned write_block(const unsigned char* elements, unsigned count) {
+      return buffer.write_block(elements, count);
+    }
 };
 
 /*
@@ -0,0 +1,175 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// analog key calibration.
+//
+// every key has a profile: the level it rests at (up) and the level
+// it reads when pushed all the way down. from those come the table the
+// scanner and the pressure reads use: the press threshold, the level
+// a pressed key has to come back above to be released (a little
+// higher, so that noise near the threshold does not chatter), the full
+// pressure level, and a scale, so that pressure is one multiply and
+// one shift.
+//
+// when tracking is on, the scanner feeds each read of the key in:
+//   - a read only counts as the middle of the last three (a median),
+//     so a single spike never moves anything.
+//   - at rest, the rest level follows the reads up quickly and down
+//     slowly, so it sits near the top of the noise (a decaying max).
+//   - the bottom follows the reads down quickly whenever they go
+//     lower. while the key is pressed near the bottom (the last quarter
+//     of its travel) it creeps back up slowly, so a sensor that cannot
+//     reach the old bottom any more still gets to full pressure (a
+//     decaying min). presses higher up leave it alone.
+// the table is only worked out again when a level moves by a whole unit.
+//
+// the scanner tracks in the timer interrupt on core 1, while core 0 reads
+// the table for pressure, reports and saving. the table is written
+// between two steps of a version count (odd while it is being written),
+// and read_table() copies it until the count is even and has not moved,
+// so core 0 never gets a new up with an old scale. the scanner never
+// waits. the profile goes in the table, so a saved profile is always one
+// the table was made from.
+struct key_profile_t {
+  int16_t rest;
+  int16_t bottom;
+};
+
+const unsigned key_pressure_bits = 16;       // 0 .. 65535 = no pressure .. full
+const int key_calibration_min_travel = 32;   // rest - bottom, in resolution units
+
+// a read below up is a press, and the key stays down until a read is
+// at or above release
+struct key_table_t {
+  int16_t rest = 1;
+  int16_t bottom = 0;
+  int16_t up = 1;
+  int16_t release = 1;
+  int16_t down = 0;
+  uint32_t scale = 0;
+  // 0 at or above up, 65535 at or below down
+  uint16_t pressure(int level) const {
+    int d = up - level;
+    int span = up - down;
+    if (d <= 0) {
+      return 0;
+    }
+    if (d >= span) {
+      return (1u << key_pressure_bits) - 1;
+    }
+    return (uint32_t)d * scale >> 8;
+  }
+};
+
+class key_calibration_obj {
+  private:
+    static constexpr unsigned rest_rise_shift = 3;
+    static constexpr unsigned rest_fall_shift = 12;
+    static constexpr unsigned bottom_fall_shift = 2;
+    static constexpr unsigned bottom_rise_shift = 10;
+    int32_t _rest = 0;       // in 1/256ths
+    int32_t _bottom = 0;
+    int16_t _prev[2] = {};   // the two reads before this one
+    uint8_t _seen = 0;
+    key_table_t _table;
+    std::atomic<unsigned> _version{0};   // odd while _table is being written
+    void publish(const key_table_t& t) {
+      unsigned v = _version.load(std::memory_order_relaxed);
+      _version.store(v + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      _table = t;
+      _version.store(v + 2, std::memory_order_release);
+    }
+    void make_table() {
+      key_table_t t;
+      int travel = rest() - bottom();
+      t.rest = rest();
+      t.bottom = bottom();
+      t.up = rest() - travel / 8;
+      t.release = rest() - travel / 16;
+      t.down = bottom() + travel / 16;
+      int span = t.up - t.down;
+      t.scale = (span > 0 ? (((1u << key_pressure_bits) - 1) << 8) / span : 0);
+      publish(t);
+    }
+    static int median(int a, int b, int c) {
+      if (a > b) {
+        int t = a;
+        a = b;
+        b = t;
+      }
+      return (c < a ? a : c > b ? b : c);
+    }
+  public:
+    void seed(key_profile_t p) {
+      _rest = p.rest * 256;
+      _bottom = p.bottom * 256;
+      _seen = 0;
+      make_table();
+    }
+    // a fixed threshold for a key that is only on or off
+    void digital() {
+      _rest = 256;
+      _bottom = 0;
+      publish(key_table_t());
+    }
+    // the table, for the core that calls track() (the scanner)
+    const key_table_t& table() {
+      return _table;
+    }
+    // the table, for the other core: a copy made by one make_table() call
+    key_table_t read_table() {
+      key_table_t t;
+      unsigned v;
+      do {
+        v = _version.load(std::memory_order_acquire);
+        t = _table;
+        std::atomic_thread_fence(std::memory_order_acquire);
+      } while ((v & 1) || _version.load(std::memory_order_relaxed) != v);
+      return t;
+    }
+    int rest() {
+      return _rest >> 8;
+    }
+    int bottom() {
+      return _bottom >> 8;
+    }
+    // for the other core, as read_table()
+    key_profile_t profile() {
+      key_table_t t = read_table();
+      return {t.rest, t.bottom};
+    }
+    // one read of the key. warming_up: take the median as the rest level
+    // outright (keys are assumed untouched then). returns true if the
+    // table changed
+    bool track(int level, bool warming_up) {
+      int x = (_seen < 2 ? level : median(_prev[0], _prev[1], level));
+      _prev[0] = _prev[1];
+      _prev[1] = level;
+      if (_seen < 2) {
+        ++_seen;
+      }
+      int rest_was = rest();
+      int bottom_was = bottom();
+      int32_t x8 = x * 256;
+      if (warming_up) {
+        _rest = x8;
+      } else if (x >= _table.up) {
+        _rest += (x8 - _rest) >> (x8 > _rest ? rest_rise_shift : rest_fall_shift);
+      }
+      if (x8 < _bottom) {
+        _bottom += (x8 - _bottom) >> bottom_fall_shift;
+      } else if (x < bottom() + (rest() - bottom()) / 4 && !(warming_up)) {
+        _bottom += (x8 - _bottom) >> bottom_rise_shift;
+      }
+      if (_bottom > _rest - key_calibration_min_travel * 256) {
+        _bottom = _rest - key_calibration_min_travel * 256;
+      }
+      if (rest() == rest_was && bottom() == bottom_was) {
+        return false;
+      }
+      make_table();
+      return true;
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <array>
+#include <Wire.h>
+#include "LittleFS.h"
+#include "calibration.h"
+
+// keeps the analog key profiles (calibration.h) in flash, so the keys
+// are right from the first read after a restart.
+//
+// load() gives every analog key of the grid its saved profile, if the
+// file is there, whole, and for a grid of the same size. save() writes
+// every key's profile as it is now. autosave() is for core 0's loop:
+// once the save period is up, it saves if some key's rest or bottom
+// has moved by the threshold since the last save. it does not save on
+// every change, to spare the flash. a save that fails is tried again
+// after the (shorter) retry period, not a whole save period later.
+//
+// grid_t is the key scanner (keys.h); only its profile calls are used.
+template <class grid_t, unsigned key_capacity>
+class key_calibration_file_obj {
+  private:
+    struct file_t {
+      uint32_t magic;
+      uint16_t version;
+      uint16_t count;
+      std::array<key_profile_t, key_capacity> profile;
+      uint32_t checksum;
+    };
+    static constexpr uint32_t magic = 0x4C41434B;  // "KCAL"
+    grid_t* _grid = nullptr;
+    const char* _path = "/key_calibration.bin";
+    unsigned long _savePeriod_mS = 600'000;
+    unsigned long _retryPeriod_mS = 60'000;
+    int _threshold = 4;
+    std::array<key_profile_t, key_capacity> _saved = {};
+    unsigned long _triedAt = 0;   // millis() of the last save, good or not
+    bool _failed = false;         // the last save did not make it to flash
+    // FNV-1a over everything before the checksum
+    static uint32_t checksum(const file_t& c) {
+      uint32_t h = 2166136261u;
+      const uint8_t* b = (const uint8_t*)&c;
+      for (unsigned i = 0; i < offsetof(file_t, checksum); ++i) {
+        h = (h ^ b[i]) * 16777619u;
+      }
+      return h;
+    }
+  public:
+    // threshold is in resolution units
+    void setup(grid_t& grid, const char* path,
+    unsigned long save_period_mS, unsigned long retry_period_mS, int threshold) {
+      _grid = &grid;
+      _path = path;
+      _savePeriod_mS = save_period_mS;
+      _retryPeriod_mS = retry_period_mS;
+      _threshold = threshold;
+    }
+    // true if a profile for this grid was found and given to the keys
+    bool load() {
+      for (unsigned i = 0; i < _grid->buttonCount(); ++i) {
+        _saved[i] = _grid->get_profile(i);
+      }
+      if (!(LittleFS.begin())) {
+        return false;
+      }
+      File f = LittleFS.open(_path, "r");
+      if (!(f)) {
+        return false;
+      }
+      file_t c;
+      bool ok = (f.read((uint8_t*)&c, sizeof(c)) == sizeof(c))
+        && (c.magic == magic) && (c.version == 1)
+        && (c.count == _grid->buttonCount())
+        && (c.checksum == checksum(c));
+      f.close();
+      if (!(ok)) {
+        return false;
+      }
+      for (unsigned i = 0; i < c.count; ++i) {
+        if (_grid->is_analog(i)) {
+          _grid->set_profile(i, c.profile[i]);
+          _saved[i] = c.profile[i];
+        }
+      }
+      return true;
+    }
+    bool save() {
+      file_t c = {};
+      c.magic = magic;
+      c.version = 1;
+      c.count = _grid->buttonCount();
+      for (unsigned i = 0; i < c.count; ++i) {
+        c.profile[i] = _grid->get_profile(i);
+      }
+      c.checksum = checksum(c);
+      _triedAt = millis();
+      _failed = true;
+      File f = LittleFS.open(_path, "w");
+      if (!(f)) {
+        return false;
+      }
+      bool ok = (f.write((const uint8_t*)&c, sizeof(c)) == sizeof(c));
+      f.close();
+      if (ok) {
+        _saved = c.profile;
+        _failed = false;
+      }
+      return ok;
+    }
+    // core 0, from loop(): save if it has been a while and a profile has moved
+    void autosave() {
+      if (millis() - _triedAt < (_failed ? _retryPeriod_mS : _savePeriod_mS)) {
+        return;
+      }
+      for (unsigned i = 0; i < _grid->buttonCount(); ++i) {
+        key_profile_t p = _grid->get_profile(i);
+        key_profile_t& s = _saved[i];
+        if (abs(p.rest - s.rest) >= _threshold
+        || abs(p.bottom - s.bottom) >= _threshold) {
+          save();
+          return;
+        }
+      }
+    }
+    // the last save that was tried did not make it to flash
+    bool save_failed() {
+      return _failed;
+    }
+};
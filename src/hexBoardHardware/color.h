@@ -0,0 +1,206 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+
+/*
+  LED colors from OKLCh, in integer math.
+
+  A color is a lightness, a chroma and a hue in
+  the OKLab color space, where equal steps look
+  like equal steps:
+    L  0 .. 255   black .. white
+    C  0 .. 255   gray .. 0.32 (about the most
+                  the LEDs can show, at any hue)
+    h  0 .. 65535 all the way round the hue circle
+                  (OKLab degrees * 65536 / 360)
+
+  The way to the LEDs, in 1/16384ths until the end:
+    L C h -> L a b      a sine table, made at compile
+                        time and kept in flash
+    L a b -> L M S      a 3x3 matrix, then each cubed
+    L M S -> linear RGB another 3x3 matrix, to 0 .. 4095;
+                        channels the LEDs cannot
+                        show are clipped
+    linear -> LED level one multiply, by the scale for
+                        the global brightness, from a
+                        table made at compile time
+                        and kept in flash. levels are
+                        kept in 1/256ths of a step
+                        (a pixel_level), so at low
+                        brightness the LED output can
+                        dither between steps; code()
+                        rounds them to whole steps
+  The matrices are Bjorn Ottosson's, rounded to
+  1/4096ths. Against the same steps in doubles,
+  every channel comes out the same or one level
+  off. WS2812 PWM is linear in light, so the LED's
+  response is a straight line; the brightness is
+  the one curve, in the scale table. It scales light by
+  (brightness / 255) ^ 2.6, so the V1 BRIGHT_ levels
+  look as they did through gamma32().
+*/
+
+struct LED_oklch_t {
+  uint8_t L;
+  uint8_t C;
+  uint16_t h;
+};
+
+// light on each channel, 0 .. 4095
+struct LED_linear_t {
+  uint16_t r;
+  uint16_t g;
+  uint16_t b;
+};
+
+const unsigned LED_linear_bits = 12;
+const int32_t LED_linear_max = (1 << LED_linear_bits) - 1;
+
+namespace LED_color_tables {
+  // sin(2 pi i / 256), in 1/16384ths. 257 entries so the last step can interpolate
+  constexpr double sin_series(double x) {
+    // x in -pi .. pi
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; ++n) {
+      term *= -x * x / ((2 * n) * (2 * n + 1));
+      sum += term;
+    }
+    return sum;
+  }
+  constexpr std::array<int16_t, 257> make_sine() {
+    std::array<int16_t, 257> t = {};
+    const double pi = 3.14159265358979323846;
+    for (int i = 0; i <= 256; ++i) {
+      double x = 2 * pi * i / 256;
+      if (x > pi) {
+        x -= 2 * pi;
+      }
+      double s = sin_series(x) * 16384;
+      t[i] = (int16_t)(s < 0 ? s - 0.5 : s + 0.5);
+    }
+    return t;
+  }
+  constexpr std::array<int16_t, 257> sine = make_sine();
+
+  // (brightness / 255) ^ 2.6 as exp(2.6 ln x), which the compiler can work out
+  constexpr double ln_series(double x) {
+    // x > 0: halve or double it into 1 .. 2, then 2 atanh((x - 1) / (x + 1))
+    double k = 0;
+    while (x >= 2) {
+      x /= 2;
+      ++k;
+    }
+    while (x < 1) {
+      x *= 2;
+      --k;
+    }
+    double y = (x - 1) / (x + 1);
+    double term = y;
+    double sum = 0;
+    for (int n = 1; n < 40; n += 2) {
+      sum += term / n;
+      term *= y * y;
+    }
+    return 2 * sum + k * 0.69314718055994530942;
+  }
+  constexpr double exp_series(double x) {
+    // exp(x / 64) ^ 64, so the series is taken close to 0
+    double z = x / 64;
+    double term = 1;
+    double sum = 1;
+    for (int n = 1; n < 20; ++n) {
+      term *= z / n;
+      sum += term;
+    }
+    for (int i = 0; i < 6; ++i) {
+      sum *= sum;
+    }
+    return sum;
+  }
+  // LED level (8.8: 256 is one LED step) per unit of linear light, in
+  // 1/65536ths, for each brightness. at 255, 4095 units of light times
+  // the scale is just under 2^32
+  constexpr std::array<uint32_t, 256> make_scale() {
+    std::array<uint32_t, 256> t = {};
+    for (int i = 1; i <= 255; ++i) {
+      double light = exp_series(2.6 * ln_series(i / 255.0));
+      t[i] = (uint32_t)(light * (255 << 8) / LED_linear_max * 65536 + 0.5);
+    }
+    return t;
+  }
+  constexpr std::array<uint32_t, 256> scale = make_scale();
+}
+
+class LED_color_obj {
+  private:
+    static constexpr int32_t chroma_scale = 1316;   // C * 1316 / 64 = 0.32 * 16384 at C = 255
+    uint32_t _scale = LED_color_tables::scale[255];
+    uint8_t _brightness = 255;
+    // sine of h (1/65536ths of a turn), in 1/16384ths
+    static int32_t sine(uint16_t h) {
+      unsigned i = h >> 8;
+      int32_t f = h & 0xFF;
+      int32_t s0 = LED_color_tables::sine[i];
+      int32_t s1 = LED_color_tables::sine[i + 1];
+      return s0 + (((s1 - s0) * f) >> 8);
+    }
+    static int32_t cube(int32_t x) {
+      return (((x * x) >> 14) * x) >> 14;
+    }
+    static uint16_t clip(int32_t x) {
+      return (x < 0 ? 0 : x > LED_linear_max ? LED_linear_max : x);
+    }
+    // linear light to an LED level, 8.8
+    uint16_t step(uint16_t x) {
+      return (uint16_t)((x * _scale + 32768) >> 16);
+    }
+  public:
+    void set_brightness(uint8_t brightness) {
+      _brightness = brightness;
+      _scale = LED_color_tables::scale[brightness];
+    }
+    uint8_t get_brightness() {
+      return _brightness;
+    }
+    static LED_linear_t linear(LED_oklch_t c) {
+      // L a b and L M S in 1/16384ths
+      int32_t L = (c.L * 16448) >> 8;                // 16384 / 255 = 64.25
+      int32_t chroma = (c.C * chroma_scale) >> 6;
+      int32_t a = (chroma * sine(c.h + 16384)) >> 14;  // cos
+      int32_t b = (chroma * sine(c.h)) >> 14;
+      int32_t l = cube(L + ((1623 * a + 884 * b) >> 12));
+      int32_t m = cube(L - ((432 * a + 262 * b) >> 12));
+      int32_t s = cube(L - ((367 * a + 5290 * b) >> 12));
+      // L M S down to 1/4096ths, so the last matrix fits in 32 bits
+      return {
+        clip((16698 * (l >> 2) - 13548 * (m >> 2) + 946 * (s >> 2) + 2048) >> 12),
+        clip((-5195 * (l >> 2) + 10690 * (m >> 2) - 1398 * (s >> 2) + 2048) >> 12),
+        clip((-17 * (l >> 2) - 2881 * (m >> 2) + 6994 * (s >> 2) + 2048) >> 12)
+      };
+    }
+    pixel_level level(LED_linear_t c) {
+      return {step(c.r), step(c.g), step(c.b)};
+    }
+    pixel_level level(LED_oklch_t c) {
+      return level(linear(c));
+    }
+    pixel_code code(LED_linear_t c) {
+      return ((pixel_code)((step(c.r) + 128) >> 8) << 16)
+        | ((pixel_code)((step(c.g) + 128) >> 8) << 8) | ((step(c.b) + 128) >> 8);
+    }
+    pixel_code code(LED_oklch_t c) {
+      return code(linear(c));
+    }
+    // a whole frame's worth at once
+    void convert(const LED_oklch_t* in, pixel_code* out, unsigned count) {
+      for (unsigned i = 0; i < count; ++i) {
+        out[i] = code(linear(in[i]));
+      }
+    }
+    void convert(const LED_oklch_t* in, pixel_level* out, unsigned count) {
+      for (unsigned i = 0; i < count; ++i) {
+        out[i] = level(linear(in[i]));
+      }
+    }
+};
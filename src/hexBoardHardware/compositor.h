@@ -0,0 +1,179 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+
+/*
+  Builds each LED frame out of only what changed.
+
+  Every pixel remembers the inputs it was last
+  composed from, packed into one number by the
+  caller: which of a key's stored colors it shows,
+  a wheel's value, and so on (anything but
+  LED_inputs_unknown). Each frame the caller
+  offers every pixel's inputs to changed(), and only
+  when they differ works out the color and set()s
+  it. If no color changed, show() sends nothing and
+  the LEDs keep the last frame, unless the strip is
+  dithering a color between two steps, which takes
+  a new frame every time.
+
+  invalidate() forgets every pixel's inputs, for
+  when the colors behind them change (a new palette
+  or brightness), so the next frame composes them
+  all again.
+
+  It also keeps the strip inside a power budget.
+  The sum of every channel's level is kept up to
+  date as colors are set, so the frame's current
+  is one multiply away: each LED draws idle_mA,
+  plus up to channel_mA per channel in proportion
+  to its level. If a frame would draw more than
+  the budget, the strip is scaled down at once to
+  fit; when it would draw less, the scale comes
+  back up an eighth of the way each frame, so the
+  LEDs brighten smoothly rather than jump.
+
+  Each frame is timed from its first changed()
+  to the end of show(), for the stats.
+*/
+
+const uint32_t LED_inputs_unknown = ~0u;   // compose the pixel whatever its inputs
+
+class LED_compositor_obj {
+  private:
+    LED_strip_obj* _strip = nullptr;
+    std::vector<uint32_t> _inputs;
+    bool _changed = false;        // a color changed since the last frame sent
+    unsigned _composed = 0;       // pixels worked out for the frame being built
+    unsigned _frames = 0;
+    unsigned _shown = 0;
+    unsigned long long _composedTotal = 0;
+    // compose time: from the first changed() of a frame to the end of show()
+    uint64_t _started = 0;
+    bool _timing = false;
+    unsigned long long _time_uS = 0;
+    unsigned _maxTime_uS = 0;
+    // power limit. levels in 1/256ths of a step, as in pixel_level
+    uint32_t _levelSum = 0;       // every channel of every pixel, as set
+    unsigned _budget_mA = 0;      // 0: no limit
+    unsigned _idle_mA = 0;        // per LED
+    unsigned _channel_mA = 0;     // per channel at full
+    unsigned _mA = 0;             // the last frame sent, as scaled
+    static uint32_t sum(const pixel_level& p) {
+      return (uint32_t)p.r + p.g + p.b;
+    }
+    // what the channels draw at full scale, in mA
+    uint32_t channel_current_in_mA() {
+      return ((uint64_t)_levelSum * _channel_mA + 0xFF00 / 2) / 0xFF00;
+    }
+    // true if the scale moved
+    bool limit_power() {
+      uint32_t idle = _idle_mA * _inputs.size();
+      uint32_t lit = channel_current_in_mA();
+      uint32_t target = LED_full_scale;
+      if (_budget_mA && lit && idle + lit > _budget_mA) {
+        target = (_budget_mA > idle ? ((_budget_mA - idle) << 8) / lit : 0);
+      }
+      uint32_t was = _strip->get_scale();
+      uint32_t scale = was;
+      if (target < scale) {
+        scale = target;
+      } else {
+        scale += (target - scale + 7) >> 3;
+      }
+      _strip->set_scale(scale);
+      _mA = idle + ((lit * scale) >> 8);
+      return (scale != was);
+    }
+  public:
+    void setup(LED_strip_obj& strip) {
+      _strip = &strip;
+      _inputs.assign(strip.count(), LED_inputs_unknown);
+      _levelSum = 0;
+      for (unsigned i = 0; i < strip.count(); ++i) {
+        _levelSum += sum(strip.get_pixel(i));
+      }
+    }
+    // the current the strip may draw, and what it draws (per LED idle,
+    // per channel at full). a budget of 0 is no limit
+    void set_power_budget(unsigned budget_mA, unsigned idle_mA, unsigned channel_mA) {
+      _budget_mA = budget_mA;
+      _idle_mA = idle_mA;
+      _channel_mA = channel_mA;
+      limit_power();
+    }
+    // true if the pixel has to be composed (then set() its color)
+    bool changed(unsigned pixel, uint32_t inputs) {
+      if (!(_timing)) {
+        _timing = true;
+        _started = time_us_64();
+      }
+      if (pixel >= _inputs.size() || _inputs[pixel] == inputs) {
+        return false;
+      }
+      _inputs[pixel] = inputs;
+      ++_composed;
+      return true;
+    }
+    void set(unsigned pixel, pixel_level p) {
+      pixel_level was = _strip->get_pixel(pixel);
+      if (pixel < _inputs.size() && was != p) {
+        _levelSum += sum(p) - sum(was);
+        _strip->set_pixel(pixel, p);
+        _changed = true;
+      }
+    }
+    void set(unsigned pixel, pixel_code c) {
+      set(pixel, to_pixel_level(c));
+    }
+    void invalidate() {
+      _inputs.assign(_inputs.size(), LED_inputs_unknown);
+    }
+    // end of a frame: send it if anything in it changed
+    bool show() {
+      ++_frames;
+      _composedTotal += _composed;
+      _composed = 0;
+      // after a bright frame the scale keeps coming back up, frame by frame
+      if (_changed || _strip->get_scale() != LED_full_scale) {
+        _changed |= limit_power();
+      }
+      bool send = (_changed || _strip->is_dithering());
+      if (send) {
+        _changed = false;
+        ++_shown;
+        _strip->show();
+      }
+      if (_timing) {
+        unsigned t = time_us_64() - _started;
+        _time_uS += t;
+        _maxTime_uS = (t > _maxTime_uS ? t : _maxTime_uS);
+        _timing = false;
+      }
+      return send;
+    }
+    unsigned get_frames() {
+      return _frames;
+    }
+    unsigned get_frames_shown() {
+      return _shown;
+    }
+    unsigned long long get_pixels_composed() {
+      return _composedTotal;
+    }
+    // time to compose and pack a frame, in uS
+    unsigned get_mean_frame_time_in_uS() {
+      return (_frames ? _time_uS / _frames : 0);
+    }
+    unsigned get_max_frame_time_in_uS() {
+      return _maxTime_uS;
+    }
+    // estimated current of the last frame sent, with the power limit applied
+    unsigned get_current_in_mA() {
+      return _mA;
+    }
+    // the power limit's scale, in 1/256ths
+    uint16_t get_power_scale() {
+      return _strip->get_scale();
+    }
+};
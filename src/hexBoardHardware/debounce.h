@@ -0,0 +1,102 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+
+// key debounce, as a table-driven state machine.
+// each key keeps one byte of state. every time the key is read, the
+// scanner looks up the next state from the current state and the raw
+// read (down or up), and the key's debounced output is one bit of the
+// new state. the tables are built once, for whichever algorithm is
+// selected, so the interrupt only ever does the one lookup per read.
+//
+// algorithms, with their two settings a and b (counted in reads):
+//   debounce_none        every read counts as is.
+//   debounce_integrator  a down read counts up, an up read counts down,
+//                        between 0 and a. the output goes down at a
+//                        and back up at 0.
+//   debounce_lockout     the first change counts at once, then the key
+//                        is ignored for the next a reads.
+//   debounce_asymmetric  a down reads in a row to press,
+//                        b up reads in a row to release.
+enum {
+  debounce_none = 0,
+  debounce_integrator = 1,
+  debounce_lockout = 2,
+  debounce_asymmetric = 3,
+};
+
+const unsigned debounce_max_window = 15;
+
+class debounce_table_obj {
+  private:
+    // state = output * (debounce_max_window + 1) + counter
+    static constexpr unsigned span = debounce_max_window + 1;
+    static constexpr unsigned state_count = 2 * span;
+    static constexpr uint8_t flag_down = 1;
+    static constexpr uint8_t flag_settled = 2;  // nothing pending; only a new read can change it
+    std::array<std::array<uint8_t, 2>, state_count> _next = {};
+    std::array<uint8_t, state_count> _flags = {};
+    static unsigned clamp(unsigned n) {
+      return (n < 1 ? 1 : n > debounce_max_window ? debounce_max_window : n);
+    }
+  public:
+    static constexpr uint8_t initial = 0;  // up, counter 0
+    debounce_table_obj() {
+      build(debounce_none, 1, 1);
+    }
+    void build(unsigned algorithm, unsigned a, unsigned b) {
+      a = clamp(a);
+      b = clamp(b);
+      for (unsigned o = 0; o < 2; ++o) {
+        for (unsigned c = 0; c < span; ++c) {
+          bool settled = (c == 0);
+          for (unsigned raw = 0; raw < 2; ++raw) {
+            unsigned o2 = o;
+            unsigned c2 = 0;
+            switch (algorithm) {
+              case debounce_integrator: {
+                unsigned n = (c > a ? a : c);
+                n = (raw ? (n < a ? n + 1 : a) : (n ? n - 1 : 0));
+                o2 = (n == a ? 1 : n == 0 ? 0 : o);
+                c2 = n;
+                settled = (o ? c == a : c == 0);
+                break;
+              }
+              case debounce_lockout:
+                if (c) {
+                  c2 = (c > a ? a : c) - 1;
+                } else if (raw != o) {
+                  o2 = raw;
+                  c2 = a;
+                }
+                break;
+              case debounce_asymmetric:
+                if (raw != o) {
+                  unsigned window = (o ? b : a);
+                  if (c + 1 >= window) {
+                    o2 = raw;
+                  } else {
+                    c2 = c + 1;
+                  }
+                }
+                break;
+              default:  // debounce_none
+                o2 = raw;
+                break;
+            }
+            _next[o * span + c][raw] = o2 * span + c2;
+          }
+          _flags[o * span + c] = (o ? flag_down : 0) | (settled ? flag_settled : 0);
+        }
+      }
+    }
+    uint8_t next(uint8_t state, bool raw) {
+      return _next[state][raw];
+    }
+    bool down(uint8_t state) {
+      return (_flags[state] & flag_down);
+    }
+    bool settled(uint8_t state) {
+      return (_flags[state] & flag_settled);
+    }
+};
@@ -1,15 +1,105 @@
 #pragma once
 #include <Wire.h>
 #include <vector>
-#include <deque>
+#include <array>
+#include <atomic>
+#include <string>
 #include "hardware/timer.h"
+#include "ringBuffer.h"
+#include "debounce.h"
+#include "velocity.h"
+#include "calibration.h"
 
+// poll() runs in the timer interrupt on core 1 and never stops: it reads
+// one key per call into a frame, and when every key has been read, it
+// publishes the frame and starts on the next one. there are three
+// frames, so that the scanner always has one to write into while core 0
+// holds on to the latest one it took. the two cores only share two
+// indices (which frame is latest, which one core 0 is reading), so
+// nothing here needs an atomic read-modify-write, which the RP2040
+// does not have.
+//
+// core 0 calls take_snapshot() whenever it is ready. that copies the
+// latest complete frame into the key history, which keeps the last few
+// frames for every key. frames that were published and replaced
+// before core 0 got to them are counted as dropped.
+//
+// the scanner also compares each read with the key's last state and,
+// when a key goes down or comes up, queues a key_event_t. core 0 drains
+// those with read_event(), so it only has to look at keys that changed.
+//
+// every read goes through the debounce state machine in debounce.h
+// before it can become an edge. analog keys are stepped one at a time,
+// as the sweep reads them, and a pressed key is only released once it
+// comes back above a slightly higher level than the one it went down
+// at (see calibration.h). digital keys are only on or off, so the scanner
+// packs them into bit arrays (one bit per linear_index()) and, once per
+// frame, uses a few word-wide operations to find the keys that need a
+// step: the ones whose read differs from their debounced state or from
+// their last read, or whose state is still counting. idle keys are
+// skipped 32 at a time.
+//
+// for each key the scanner also counts raw changes and edges, and the
+// time from the read that started a change to the edge it produced
+// (the latency added by debouncing). raw changes that never became an
+// edge are bounces. see debounce_report().
+//
+// the scan is adaptive for analog keys. the sweep still reads every key
+// in turn, but after each sweep read the scanner may spend a few reads
+// on "hot" keys: ones that are down, or that moved by more than a
+// threshold, within the last few sweeps. those get read many times per
+// frame, which is what pressure and aftertouch need. each sweep read is
+// followed by at most hot_per_sweep hot reads, so a full sweep always
+// finishes within keys * (1 + hot_per_sweep) polls, see
+// get_sweep_deadline_in_polls(). with no hot keys the scan is the
+// plain sweep. the frame keeps the newest read of each key, how many
+// reads it got, for get_sample_rate_in_Hz(), and their sum. pressure
+// comes from the mean of every read of the key in the frame, so a hot
+// key, read a hundred times or more a frame, gives a steadier pressure
+// than its one sweep read would.
+//
+// analog keys calibrate themselves as they are scanned (calibration.h):
+// each sweep read moves the key's rest and bottom-out levels, and with
+// them its press threshold and pressure scale. the profiles can be
+// saved and given back at boot with get_profile() / set_profile(), and
+// with no saved profile the first few sweeps take every key's rest
+// level as is (the warm-up).
+//
+// analog keys also get a least-squares fit over their last few reads
+// (velocity.h). the scanner keeps the sums up to date as it reads and
+// puts the fit in the frame, so core 0 reads velocity and acceleration
+// from the frame it took, and each press or release event carries a
+// MIDI velocity from the velocity curve.
+//
+// the history is a fixed ring per key, sized at compile time, and
+// nothing is allocated after setup(). the rings are stored side by
+// side: all the levels in one array and all the time stamps in another,
+// key i's slots at [i * history ...].
+enum {
+  key_edge_press = 1,    // same codes as read_keypress()
+  key_edge_release = 2,
+};
+
+struct key_event_t {
+  uint32_t time_uS;   // low 32 bits of the timer when the key was read
+  uint8_t key;        // linear_index() of the key
+  uint8_t edge;       // key_edge_press or key_edge_release
+  int16_t velocity;   // resolution units per millisecond, negative = moving down;
+                      // undefined for digital keys (always 0)
+  int16_t level;      // the read itself
+  uint8_t midi_velocity;  // 1-127 from the velocity curve; 0 for digital keys
+};
+
+const unsigned key_event_queue_size = 64;
+const unsigned key_hot_list_size = 16;
+
+template <unsigned key_capacity, unsigned history, unsigned velocity_window = 8>
 class pinGrid_obj {
+  static_assert(key_capacity <= 256, "key events store the key index as a byte");
+  static_assert(history >= 2, "need at least two reads per key");
   private:
     bool _isEnabled;
     bool _cycle_mux_pins_first;
-    bool _readComplete;
-    unsigned _keystrokes_retained;
     unsigned _colSize;
     unsigned _colCounter;
     std::vector<bool> _isAnalogPin;
@@ -19,15 +109,227 @@ class pinGrid_obj {
     std::vector<unsigned> _muxPins;
     unsigned _muxMaxValue;
     unsigned _keyCount;
-    unsigned _gridCounter;
     struct _keyData {
       bool isAnalog;
-      int calibrate_up;
-      int calibrate_down;
-      std::deque<int> _level;
-      std::deque<unsigned long long int> _time;
+      key_calibration_obj cal;   // core 0 reads its table with read_table() (see calibration.h)
+    };
+    std::array<_keyData, key_capacity> _key;
+    // one complete read of the grid
+    struct _frameData {
+      unsigned sequence = 0;         // 1 for the first frame scanned
+      unsigned period_uS = 0;        // time since the frame before it
+      unsigned long long int finished = 0;
+      std::array<int16_t, key_capacity> level = {};
+      std::array<unsigned long long int, key_capacity> time = {};
+      std::array<key_motion_t, key_capacity> motion = {};  // analog keys only
+      std::array<uint16_t, key_capacity> reads = {};       // reads of each key in this frame
+      std::array<uint32_t, key_capacity> sum = {};         // of the levels of those reads
+    };
+    std::array<_frameData, 3> _frame;
+    // scanner side (core 1)
+    unsigned _back = 1;              // frame being written
+    std::atomic<unsigned> _frameCount{0};  // written by the scanner
+    debounce_table_obj _debounce;
+    velocity_curve_obj _curve;
+    std::array<key_motion_obj<velocity_window>, key_capacity> _motion;
+    // adaptive scan
+    unsigned _selCol = 0;            // key the pins are set to, read on the next poll
+    unsigned _selMux = 0;
+    bool _selIsSweep = true;         // false = a hot read, the sweep does not move
+    unsigned _hotPerSweep = 0;
+    bool _autoCalibrate = false;
+    unsigned _warmUp = 0;            // sweeps left that take the rest level as is
+    unsigned _hotLinger = 0;         // sweeps a key stays hot after it was last active
+    int _hotThreshold = 0;           // change between two reads that counts as active
+    std::array<uint8_t, key_hot_list_size> _hotList = {};
+    unsigned _hotCount = 0;
+    unsigned _hotNext = 0;           // round robin position in the list
+    unsigned _hotDone = 0;           // hot reads since the last sweep read
+    std::array<uint8_t, key_capacity> _hotLeft = {};  // sweeps left, 0 = not on the list
+    std::array<uint8_t, key_capacity> _bounceState = {};
+    // one bit per key
+    static constexpr unsigned key_words = (key_capacity + 31) / 32;
+    std::array<uint32_t, key_words> _digitalMask = {};  // which bits are digital keys
+    std::array<uint32_t, key_words> _raw = {};          // digital reads this frame
+    std::array<uint32_t, key_words> _lastRaw = {};      // read before the one being stepped
+    std::array<uint32_t, key_words> _debounced = {};    // output of the debounce state
+    std::array<uint32_t, key_words> _busy = {};         // debounce state still counting
+    // written by the scanner, read by core 0 for reports only
+    struct _bounceStats {
+      uint32_t rawChanges = 0;
+      uint32_t edges = 0;
+      uint32_t rawSince = 0;      // time of the read that started the current raw state
+      uint32_t latencyTotal_uS = 0;
+      uint32_t latencyMax_uS = 0;
     };
-    std::vector<_keyData> _key;
+    std::array<_bounceStats, key_capacity> _bounce;
+    static void set_bit(std::array<uint32_t, key_words>& a, unsigned i, bool b) {
+      if (b) {
+        a[i >> 5] |= (1u << (i & 31));
+      } else {
+        a[i >> 5] &= ~(1u << (i & 31));
+      }
+    }
+    static bool get_bit(const std::array<uint32_t, key_words>& a, unsigned i) {
+      return (a[i >> 5] >> (i & 31)) & 1;
+    }
+    ringBuffer_obj<key_event_queue_size, key_event_t> _events;
+    std::atomic<unsigned> _eventsLost{0};  // written by the scanner
+    std::atomic<unsigned> _latest{0};   // written by the scanner
+    std::atomic<unsigned> _reading{0};  // written by core 0
+    // reader side (core 0)
+    unsigned _taken = 0;             // sequence of the last frame taken
+    unsigned _dropped = 0;
+    unsigned _scanPeriod = 0;
+    std::array<int16_t, key_capacity * history> _level;
+    std::array<unsigned long long int, key_capacity * history> _time;
+    std::array<int16_t, key_capacity> _meanLevel;   // of the last frame taken
+    unsigned _newest = 0;  // slot written last
+    unsigned _filled = 0;  // frames held, up to history
+    // position of the read "lookback" frames before the newest
+    unsigned slot(unsigned i, unsigned lookback) {
+      unsigned n = _newest;
+      return i * history + (n >= lookback ? n - lookback : n + history - lookback);
+    }
+    // the frame take_snapshot() claimed stays put until the next call
+    const key_motion_t& taken_motion(unsigned i) {
+      return _frame[_reading.load()].motion[i];
+    }
+    unsigned long long int read_timer() {
+      unsigned long long int t = timer_hw->timerawh;
+      return (t << 32) | timer_hw->timerawl;
+    }
+    // scanner: a key changed. analog keys take their velocity from the
+    // fit; a switch has no travel to measure, so digital keys get 0.
+    // if the queue is full the edge is counted as lost and the key keeps
+    // its old state, so the edge is tried again on the next frame.
+    bool queue_edge(unsigned i, bool down, int level, unsigned long long int t) {
+      long long int v;
+      key_event_t e;
+      if (_key[i].isAnalog) {
+        int32_t per_s = key_motion_obj<velocity_window>::velocity_per_s(
+          _frame[_back].motion[i]);
+        v = per_s / 1000;
+        e.midi_velocity = _curve.midi_velocity(per_s);
+      } else {
+        v = 0;
+        e.midi_velocity = 0;
+      }
+      e.time_uS = (uint32_t)t;
+      e.key = i;
+      e.edge = (down ? key_edge_press : key_edge_release);
+      e.velocity = (v > 32767 ? 32767 : v < -32767 ? -32767 : v);
+      e.level = level;
+      if (_events.write(e)) {
+        return true;
+      }
+      _eventsLost.store(_eventsLost.load() + 1);
+      return false;
+    }
+    // scanner: run one read of key i through its debounce state.
+    // if the edge does not fit in the queue, the state is left as it was,
+    // so the same edge comes out of the next read.
+    void debounce_step(unsigned i, bool raw, int level, unsigned long long int t) {
+      auto& s = _bounce[i];
+      if (raw != get_bit(_lastRaw, i)) {
+        set_bit(_lastRaw, i, raw);
+        s.rawSince = t;
+        ++s.rawChanges;
+      }
+      const uint8_t state = _bounceState[i];
+      const uint8_t next = _debounce.next(state, raw);
+      const bool down = _debounce.down(next);
+      if (down != _debounce.down(state)) {
+        if (!(queue_edge(i, down, level, t))) {
+          return;
+        }
+        uint32_t added = (uint32_t)t - s.rawSince;
+        ++s.edges;
+        s.latencyTotal_uS += added;
+        if (added > s.latencyMax_uS) {
+          s.latencyMax_uS = added;
+        }
+        set_bit(_debounced, i, down);
+      }
+      _bounceState[i] = next;
+      set_bit(_busy, i, !(_debounce.settled(next)));
+    }
+    // scanner, once per frame: step the digital keys that need it
+    void digital_edges(const _frameData& f) {
+      for (unsigned w = 0; w < key_words; ++w) {
+        const uint32_t raw = _raw[w];
+        uint32_t todo = ((raw ^ _debounced[w]) | (raw ^ _lastRaw[w]) | _busy[w]) & _digitalMask[w];
+        while (todo) {
+          unsigned b = __builtin_ctz(todo);
+          todo &= todo - 1;
+          unsigned i = w * 32 + b;
+          debounce_step(i, (raw >> b) & 1, f.level[i], f.time[i]);
+        }
+      }
+    }
+    // scanner: an analog key was read. keep it on the hot list while it is active
+    void track_activity(unsigned i, bool active) {
+      if (!(active) || !(_hotPerSweep)) {
+        return;
+      }
+      if (!(_hotLeft[i])) {
+        if (_hotCount == key_hot_list_size) {
+          return;
+        }
+        _hotList[_hotCount++] = i;
+      }
+      _hotLeft[i] = _hotLinger + 1;
+    }
+    // scanner, once per frame: drop the keys that have been idle long enough
+    void age_hot_keys() {
+      for (unsigned h = 0; h < _hotCount; ) {
+        unsigned i = _hotList[h];
+        if (--_hotLeft[i]) {
+          ++h;
+        } else {
+          _hotList[h] = _hotList[--_hotCount];
+        }
+      }
+      if (_hotNext >= _hotCount) {
+        _hotNext = 0;
+      }
+    }
+    // scanner: set the pins for the next read. the pins then have a full
+    // poll period to settle before the key is read.
+    void select_key(unsigned c, unsigned m) {
+      if (c != _selCol) {
+        col_pin_off(_selCol);
+        col_pin_on(c);
+      }
+      for (unsigned b = 0; b < _muxSize; b++) {
+        if (((m ^ _selMux) >> b) & 1) {
+          digitalWrite(_muxPins[b], (m >> b) & 1);
+        }
+      }
+      _selCol = c;
+      _selMux = m;
+    }
+    // scanner: hand the finished frame over and pick the next one to write,
+    // which must be neither the one just published nor the one core 0 has
+    void publish_frame() {
+      auto& f = _frame[_back];
+      unsigned long long int now = read_timer();
+      auto& previous = _frame[_latest.load()];
+      f.sequence = _frameCount.load() + 1;
+      f.period_uS = (previous.finished ? now - previous.finished : 0);
+      f.finished = now;
+      _latest.store(_back);
+      _frameCount.store(f.sequence);
+      unsigned r = _reading.load();
+      for (unsigned b = 0; b < _frame.size(); ++b) {
+        if (b != _back && b != r) {
+          _back = b;
+          break;
+        }
+      }
+      _frame[_back].reads.fill(0);
+      _frame[_back].sum.fill(0);
+    }
     void col_pin_on(unsigned c) {
       // this action only needs to happen for digital reads
       if (!(_isAnalogPin[c])) {
@@ -49,75 +351,98 @@ class pinGrid_obj {
       }
     }
     void init_key_data() {
-      _key.resize(_keyCount);
-      for (auto& k : _key) {
-        k._level.clear();
-        k._time.clear();
+      _level.fill(0);
+      _time.fill(0);
+      _meanLevel.fill(0);
+      _newest = 0;
+      _filled = 0;
+      _bounceState.fill(debounce_table_obj::initial);
+      _bounce.fill(_bounceStats());
+      _digitalMask.fill(0);
+      _raw.fill(0);
+      _lastRaw.fill(0);
+      _debounced.fill(0);
+      _busy.fill(0);
+      _events.init();
+      for (auto& m : _motion) {
+        m.clear();
       }
+      _hotLeft.fill(0);
+      _hotCount = 0;
+      _hotNext = 0;
+      _hotDone = 0;
       for (unsigned c = 0; c < _colSize; ++c) {
         for (unsigned m = 0; m < _muxMaxValue; ++m) {
-          _key[linear_index(c,m)].isAnalog = _isAnalogPin[c];
+          unsigned i = linear_index(c,m);
+          _key[i].isAnalog = _isAnalogPin[c];
+          if (!(_isAnalogPin[c])) {
+            _digitalMask[i >> 5] |= (1u << (i & 31));
+          }
         }
       }
     }
-    void calibrate_by_ref(_keyData& k, int up_level, int down_level) {
-      k.calibrate_up = up_level;
-      k.calibrate_down = down_level;
-    }
-    void calibrate_keys(int up_level, int down_level) {
+    void calibrate_keys(int rest_level, int bottom_level) {
       for (auto& k : _key) {
         if (k.isAnalog) {
-          calibrate_by_ref(k, up_level, down_level);
+          k.cal.seed({(int16_t)rest_level, (int16_t)bottom_level});
         } else {
-          calibrate_by_ref(k, 1, 0);
+          k.cal.digital();
         }
       }
     }
+    // move the sweep on; select_key() sets the pins
     bool advanceCol() {
-      col_pin_off(_colPins[_colCounter]);
-      _colCounter = (++_colCounter) % _colSize;
-      col_pin_on(_colPins[_colCounter]);
+      _colCounter = (_colCounter + 1) % _colSize;
       return (!(_colCounter));
     }
     bool advanceMux() {
-      _muxCounter = (++_muxCounter) % _muxMaxValue;
-      for (unsigned b = 0; b < _muxSize; b++) {
-        digitalWrite(_muxPins[b], (_muxCounter >> b) & 1);
-      }
+      _muxCounter = (_muxCounter + 1) % _muxMaxValue;
       return (!(_muxCounter));
     }
-    bool keyDown(_keyData &k, unsigned lookback) {
-      if (lookback >= k._level.size()) {
-        return false;
+    // with the same hysteresis as the scanner: a read between up and
+    // release leaves the key as the read before it had it
+    bool keyDown(unsigned i, unsigned lookback) {
+      key_table_t t = _key[i].cal.read_table();
+      for (unsigned l = lookback; l < _filled; ++l) {
+        int level = _level[slot(i, l)];
+        if (level < t.up) {
+          return true;
+        }
+        if (level >= t.release) {
+          return false;
+        }
       }
-      return (k._level[k._level.size() - 1 - lookback] < k.calibrate_up);
+      return false;
     }
   public:
     unsigned linear_index(unsigned c, unsigned m) {
       return ((c << _muxSize) | m);
     }
-    void resume_background_process() {
-      _readComplete = false;
-      _gridCounter = 0;
-    }
     void setup(std::vector<unsigned> colPins, std::vector<bool> isAnalog,
-    std::vector<unsigned> muxPins, bool cycleMuxFirst, unsigned keystrokesToRetain, 
+    std::vector<unsigned> muxPins, bool cycleMuxFirst,
     int default_calibrate_up, int default_calibrate_down) {
       _colPins = colPins;
       _isAnalogPin = isAnalog;
       _muxPins = muxPins;
       _cycle_mux_pins_first = cycleMuxFirst;
-      _keystrokes_retained = keystrokesToRetain;  
       init_pin_states();
       _colSize = _colPins.size();
       _muxSize = _muxPins.size();
       _muxMaxValue = (1u << _muxSize);
       _keyCount = (_colSize << _muxSize);
+      // more keys than the rings were sized for: leave the grid off
+      _isEnabled = (_keyCount <= key_capacity);
+      if (!(_isEnabled)) {
+        _keyCount = 0;
+        return;
+      }
       init_key_data();
       calibrate_keys(default_calibrate_up, default_calibrate_down);
       _colCounter = 0;
       _muxCounter = 0;
-      resume_background_process();
+      _selCol = 0;
+      _selMux = 0;
+      _selIsSweep = true;
     }
     int get_pin_state(unsigned pin, bool analog) {
       if (analog) {
@@ -126,73 +451,281 @@ class pinGrid_obj {
       return digitalRead(pin);
     }
     void poll() {
-      if (!(_readComplete)) {
-        auto& k = _key[linear_index(_colCounter,_muxCounter)];
-        if (k._time.size() >= _keystrokes_retained) {
-          k._time.pop_front();
-        }
-        unsigned long long int t = timer_hw->timerawh;
-        t = (t << 32) | timer_hw->timerawl;
-        k._time.emplace_back(t);
-        if (k._level.size() >= _keystrokes_retained) {
-          k._level.pop_front();
+      if (!(_isEnabled)) {
+        return;
+      }
+      auto& f = _frame[_back];
+      unsigned i = linear_index(_selCol, _selMux);
+      unsigned long long int t = read_timer();
+      int level = get_pin_state(
+        _colPins[_selCol], _isAnalogPin[_selCol]
+      );
+      f.time[i] = t;
+      f.level[i] = level;
+      ++f.reads[i];
+      f.sum[i] += level;
+      auto& cal = _key[i].cal;
+      const key_table_t& table = cal.table();
+      bool down = (level < (_debounce.down(_bounceState[i]) ? table.release : table.up));
+      if (_isAnalogPin[_selCol]) {
+        // hot reads come a few uS after the sweep read, so only sweep
+        // reads go into the fit and step the debounce (its settings are
+        // in sweeps). hot reads still go into the frame (the newest
+        // level and the mean that pressure comes from) and keep the key
+        // in play
+        auto& k = _motion[i];
+        int moved = (k.count() ? level - k.newest() : 0);
+        if (_selIsSweep) {
+          if (_autoCalibrate) {
+            cal.track(level, _warmUp);
+          }
+          k.push(level, t);
+          f.motion[i] = k.motion();
+          debounce_step(i, down, level, t);
         }
-        k._level.emplace_back(get_pin_state(
-          _colPins[_colCounter], _isAnalogPin[_colCounter]
-        ));
-        ++_gridCounter;
+        track_activity(i, down || moved >= _hotThreshold || -moved >= _hotThreshold);
+      } else {
+        set_bit(_raw, i, down);
+      }
+      bool frameComplete = false;
+      if (_selIsSweep) {
         if (_cycle_mux_pins_first) {
-          if (advanceMux()) { 
-            _readComplete = advanceCol();
-          }
+          frameComplete = (advanceMux() && advanceCol());
         } else {
-          if (advanceCol()) {
-            _readComplete = advanceMux();
-          }
+          frameComplete = (advanceCol() && advanceMux());
         }
+        _hotDone = 0;
+      } else {
+        ++_hotDone;
+      }
+      if (frameComplete) {
+        if (_warmUp) {
+          --_warmUp;
+        }
+        digital_edges(f);
+        age_hot_keys();
+        publish_frame();
+      }
+      // next read: a hot key if this sweep read still has some owed, else the sweep
+      _selIsSweep = !(_hotCount && _hotDone < _hotPerSweep);
+      if (_selIsSweep) {
+        select_key(_colCounter, _muxCounter);
+      } else {
+        unsigned h = _hotList[_hotNext];
+        _hotNext = (_hotNext + 1 < _hotCount ? _hotNext + 1 : 0);
+        select_key(col_of(h), mux_of(h));
+      }
+    }
+    // core 0: copy the latest complete frame into the key history.
+    // returns false if no frame has been published since the last call.
+    bool take_snapshot() {
+      // claim the latest frame, then make sure it was still the latest
+      // once the claim was visible, so the scanner cannot be writing it
+      unsigned x = _latest.load();
+      unsigned claimed;
+      do {
+        claimed = x;
+        _reading.store(claimed);
+        x = _latest.load();
+      } while (x != claimed);
+      auto& f = _frame[claimed];
+      if (f.sequence == _taken) {
+        return false;
       }
+      _dropped += f.sequence - _taken - 1;
+      _taken = f.sequence;
+      _scanPeriod = f.period_uS;
+      unsigned n = _newest + 1;
+      _newest = (n < history ? n : 0);
+      if (_filled < history) {
+        ++_filled;
+      }
+      for (unsigned i = 0; i < _keyCount; ++i) {
+        _level[i * history + _newest] = f.level[i];
+        _time[i * history + _newest] = f.time[i];
+        _meanLevel[i] = (f.reads[i] ? (f.sum[i] + f.reads[i] / 2) / f.reads[i] : f.level[i]);
+      }
+      return true;
+    }
+    // pick the debounce algorithm and its settings (see debounce.h).
+    // call this before the background process starts; it resets every key.
+    void set_debounce(unsigned algorithm, unsigned a, unsigned b) {
+      _debounce.build(algorithm, a, b);
+      _bounceState.fill(debounce_table_obj::initial);
+      _debounced.fill(0);
+      _busy.fill(0);
+    }
+    // how key speed maps to MIDI velocity (see velocity.h).
+    // like set_debounce(), call this before the background process starts.
+    void set_velocity_curve(uint32_t full_speed_per_s, unsigned shape_percent) {
+      _curve.build(full_speed_per_s, shape_percent);
+    }
+    void load_velocity_curve(const std::array<uint8_t, 128>& table) {
+      _curve.load(table);
+    }
+    // adaptive scan: after each sweep read, up to hot_per_sweep reads of
+    // keys in play (0 = plain sweep). a key stays in play for
+    // linger_sweeps after it was last down or moved by threshold.
+    // call this before the background process starts.
+    void set_scan_schedule(unsigned hot_per_sweep, unsigned linger_sweeps, int threshold) {
+      _hotPerSweep = hot_per_sweep;
+      _hotLinger = (linger_sweeps < 254 ? linger_sweeps : 254);
+      _hotThreshold = (threshold > 1 ? threshold : 1);
+      _hotLeft.fill(0);
+      _hotCount = 0;
+      _hotNext = 0;
+    }
+    // worst case, in polls of the scanner, for one full sweep of the grid
+    unsigned get_sweep_deadline_in_polls() {
+      return _keyCount * (1 + _hotPerSweep);
+    }
+    // how often the key was read, as of the last frame taken
+    unsigned get_sample_rate_in_Hz(unsigned atM, unsigned atC) {
+      auto& f = _frame[_reading.load()];
+      return (f.period_uS ? f.reads[linear_index(atC, atM)] * 1'000'000u / f.period_uS : 0);
+    }
+    // keys on the hot list right now (read by core 0 for reports only)
+    unsigned get_hot_key_count() {
+      return _hotCount;
+    }
+    unsigned get_raw_changes(unsigned i) {
+      return _bounce[i].rawChanges;
+    }
+    unsigned get_edges(unsigned i) {
+      return _bounce[i].edges;
+    }
+    // raw changes that never became an edge
+    unsigned get_bounces(unsigned i) {
+      auto& s = _bounce[i];
+      return (s.rawChanges > s.edges ? s.rawChanges - s.edges : 0);
     }
-    bool is_background_process_complete() {
-      return _readComplete;
+    unsigned get_mean_added_latency_uS(unsigned i) {
+      auto& s = _bounce[i];
+      return (s.edges ? s.latencyTotal_uS / s.edges : 0);
     }
-    void calibrate(unsigned atM, unsigned atC, int up_level, int down_level) {
-      auto& k = _key[linear_index(atC, atM)];
-      calibrate_by_ref(k, up_level, down_level);
+    unsigned get_max_added_latency_uS(unsigned i) {
+      return _bounce[i].latencyMax_uS;
+    }
+    // one line per key, e.g. to send to the log on request
+    std::string debounce_report(unsigned i) {
+      auto& s = _bounce[i];
+      return "key " + std::to_string(i)
+        + " (" + std::to_string(col_of(i)) + "C " + std::to_string(mux_of(i)) + "M)"
+        + " raw changes " + std::to_string(s.rawChanges)
+        + " edges " + std::to_string(s.edges)
+        + " bounces " + std::to_string(get_bounces(i))
+        + " | added latency uS mean " + std::to_string(get_mean_added_latency_uS(i))
+        + " max " + std::to_string(s.latencyMax_uS);
+    }
+    // core 0: next key that went down or came up, oldest first
+    bool read_event(key_event_t& e) {
+      return _events.read(e);
+    }
+    // edges that did not fit in the queue (they are retried, so late rather than gone)
+    unsigned get_lost_events() {
+      return _eventsLost.load();
+    }
+    unsigned col_of(unsigned i) {
+      return (i >> _muxSize);
+    }
+    unsigned mux_of(unsigned i) {
+      return (i & (_muxMaxValue - 1));
+    }
+    // frames scanned so far
+    unsigned get_frame_count() {
+      return _frameCount.load();
+    }
+    // frames that were replaced by a newer one before take_snapshot() saw them
+    unsigned get_dropped_frames() {
+      return _dropped;
+    }
+    // time to scan the whole grid once, as of the last frame taken
+    unsigned get_scan_period_uS() {
+      return _scanPeriod;
+    }
+    unsigned get_scan_rate_in_Hz() {
+      return (_scanPeriod ? 1'000'000 / _scanPeriod : 0);
+    }
+    // give a key its rest and bottom-out levels. with auto-calibration on,
+    // it carries on from there
+    void calibrate(unsigned atM, unsigned atC, int rest_level, int bottom_level) {
+      set_profile(linear_index(atC, atM), {(int16_t)rest_level, (int16_t)bottom_level});
+    }
+    // keep every analog key calibrated as it is scanned. warm_up_sweeps:
+    // how many sweeps to take the rest levels as read, which should be 0
+    // if the profiles were just loaded. call before the background process starts.
+    void set_auto_calibration(bool on, unsigned warm_up_sweeps) {
+      _autoCalibrate = on;
+      _warmUp = (on ? warm_up_sweeps : 0);
+    }
+    bool is_analog(unsigned i) {
+      return _key[i].isAnalog;
+    }
+    key_profile_t get_profile(unsigned i) {
+      return _key[i].cal.profile();
+    }
+    // for profiles saved earlier; analog keys only. call before the
+    // background process starts
+    void set_profile(unsigned i, key_profile_t p) {
+      if (_key[i].isAnalog) {
+        _key[i].cal.seed(p);
+      }
+    }
+    // as of the last frame taken
+    std::string calibration_report(unsigned i) {
+      key_table_t t = _key[i].cal.read_table();
+      int level = _level[slot(i, 0)];
+      return "key " + std::to_string(i)
+        + " (" + std::to_string(col_of(i)) + "C " + std::to_string(mux_of(i)) + "M)"
+        + " rest " + std::to_string(t.rest)
+        + " bottom " + std::to_string(t.bottom)
+        + " | press below " + std::to_string(t.up)
+        + " full at " + std::to_string(t.down)
+        + " | now " + std::to_string(level)
+        + " pressure " + std::to_string(t.pressure(_meanLevel[i]) * 100u / 65535u) + "%";
     }
     int read_key_state(unsigned atM, unsigned atC) {
-      auto& k = _key[linear_index(atC, atM)];
-      return k._level.back();
+      return _level[slot(linear_index(atC, atM), 0)];
     }
     unsigned long long int read_time_stamp(unsigned atM, unsigned atC) {
-      auto& k = _key[linear_index(atC, atM)];
-      return k._time.back();
+      return _time[slot(linear_index(atC, atM), 0)];
     }
     int read_keypress(unsigned atM, unsigned atC) {
       // 0 neutral 1 press 2 release 3 hold
-      auto& k = _key[linear_index(atC, atM)];
-      return (keyDown(k, 1) << 1) | keyDown(k, 0);
+      unsigned i = linear_index(atC, atM);
+      return (keyDown(i, 1) << 1) | keyDown(i, 0);
     }
+    // the velocity and acceleration below are as of the last frame taken,
+    // and only measured for analog keys (0 otherwise).
     // negative means moving down, positive means moving up
+    int read_velocity_per_s(unsigned atM, unsigned atC) {
+      unsigned i = linear_index(atC, atM);
+      return key_motion_obj<velocity_window>::velocity_per_s(taken_motion(i));
+    }
+    int read_acceleration_per_s2(unsigned atM, unsigned atC) {
+      unsigned i = linear_index(atC, atM);
+      return key_motion_obj<velocity_window>::acceleration_per_s2(taken_motion(i));
+    }
     // expressed in resolution units per millisecond
     double read_velocity(unsigned atM, unsigned atC) {
-      auto& k = _key[linear_index(atC, atM)];
-      if (k._level.size() < 2) {
-        return 0.0;
-      }
-      return       ( k._level.back() - k._level.front() )
-        / (1000.0 * ( k._time.back() - k._time.front() )); 
+      return read_velocity_per_s(atM, atC) / 1000.0;
+    }
+    uint8_t read_midi_velocity(unsigned atM, unsigned atC) {
+      return _curve.midi_velocity(read_velocity_per_s(atM, atC));
     }
-    // return as percentage from 0 to 100 based on calibration
+    // return as a fraction from 0 to 1 based on calibration, from the
+    // mean of the key's reads in the last frame taken
     double read_pressure(unsigned atM, unsigned atC) {
-      auto& k = _key[linear_index(atC, atM)];
-      double p = (k.calibrate_up - k._level.back()) / (k.calibrate_up - k.calibrate_down);
-      if (p > 1) {
-        return 1.0;
-      }
-      if (p < 0) {
-        return 0.0;
-      }
-      return p;
+      unsigned i = linear_index(atC, atM);
+      return pressure_of(i, _meanLevel[i]);
+    }
+    // the same, for a level from a key_event_t
+    double pressure_of(unsigned i, int level) {
+      return pressure_u16_of(i, level) / 65535.0;
+    }
+    // 0 .. 65535, one multiply and shift
+    uint16_t pressure_u16_of(unsigned i, int level) {
+      return _key[i].cal.read_table().pressure(level);
     }
     unsigned colPinCount() {
       return _colSize;
@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+// single-producer, single-consumer ring buffer, e.g. of audio samples
+// (core 1 writes, the timer IRQ reads) or of key events (the timer IRQ
+// writes, core 0 reads). each side owns one index and only ever loads
+// the other one.
+// that makes every operation a plain load or store, which the RP2040
+// (a Cortex-M0+ with no atomic read-modify-write) can do lock-free.
+// the indices run freely and wrap at 2^32; the capacity is a power of two
+// so the slot is found with a mask instead of a % division.
+template <unsigned capacity, typename T = unsigned char>
+struct ringBuffer_obj {
+  static_assert(capacity && !(capacity & (capacity - 1)), "ring buffer capacity must be a power of two");
+  static constexpr unsigned mask = capacity - 1;
+  // keep each index in its own 32-byte block so the two cores' writes
+  // do not share a bus line
+  alignas(32) std::atomic<unsigned> indexWrite{0};
+  alignas(32) std::atomic<unsigned> indexRead{0};
+  alignas(32) std::array<T, capacity> buffer;
+  void init() {
+    indexWrite.store(0, std::memory_order_relaxed);
+    indexRead.store(0, std::memory_order_relaxed);
+  }
+  // number of elements waiting to be read
+  unsigned size() {
+    return indexWrite.load(std::memory_order_acquire) - indexRead.load(std::memory_order_acquire);
+  }
+  unsigned spaceLeft() {
+    return capacity - size();
+  }
+  // producer side
+  bool write(const T& element) {
+    unsigned w = indexWrite.load(std::memory_order_relaxed);
+    if (w - indexRead.load(std::memory_order_acquire) >= capacity) {
+      return false;
+    }
+    buffer[w & mask] = element;
+    indexWrite.store(w + 1, std::memory_order_release);
+    return true;
+  }
+  // copy as many of the elements as fit, publish them all at once,
+  // and return how many were taken
+  unsigned write_block(const T* elements, unsigned count) {
+    unsigned w = indexWrite.load(std::memory_order_relaxed);
+    unsigned room = capacity - (w - indexRead.load(std::memory_order_acquire));
+    if (count > room) {
+      count = room;
+    }
+    unsigned first = std::min(count, capacity - (w & mask));
+    std::copy(elements, elements + first, buffer.begin() + (w & mask));
+    std::copy(elements + first, elements + count, buffer.begin());
+    indexWrite.store(w + count, std::memory_order_release);
+    return count;
+  }
+  // consumer side
+  bool read(T& element) {
+    unsigned r = indexRead.load(std::memory_order_relaxed);
+    if (indexWrite.load(std::memory_order_acquire) == r) {
+      return false;
+    }
+    element = buffer[r & mask];
+    indexRead.store(r + 1, std::memory_order_release);
+    return true;
+  }
+};
@@ -1,7 +1,11 @@
 #pragma once
-#include <deque>
+#include <stdint.h>
+#include <array>
+#include <atomic>
 #include "hardware/timer.h"
+#include "hardware/irq.h"
 #include <Wire.h>
+#include "ringBuffer.h"
 
 /*
   Documentation:
@@ -28,25 +32,228 @@
     0        Knob is in neutral state
     1, 2, 3  CCW turn state 1, 2, 3
     4, 5, 6   CW turn state 1, 2, 3
-    8, 16    Completed turn CCW, CW
+    8, 16    Completed turn CCW, CW (step +1, -1)
+
+  A contact that bounces only moves the state back
+  and forth between neighbours, and a step the poll
+  missed (both pins changed between two reads) sends
+  it back to neutral, so neither can produce a turn
+  in the wrong direction; the missed ones are counted.
+
+  there are two ways to drive the decoder, picked at
+  build time (rotary_edge_triggered in the hardware
+  config):
+    polled        the task manager calls poll() every
+                  rotary_pin_fire_period_in_uS.
+    edge          on_edge() runs on every change of
+                  pin A, B or C, from the GPIO
+                  interrupt. the button's debounce and
+                  its long press / double click timers
+                  need a clock, so while one of them
+                  is running a one-shot timer alarm
+                  calls on_alarm(). a knob nobody is
+                  touching costs nothing.
+  all of the rotary interrupts run on core 1 at the
+  same priority, so there is only ever one writer.
+
+  either way the decoder turns all of this into
+  rotary_event_t's, which core 0 reads with
+  read_event(). the queue is the same lock-free ring
+  as the key events, so nothing is allocated and
+  neither side ever waits on the other.
+    turn          one detent. step is +1 / -1 and
+                  amount is the step scaled by how
+                  fast the knob is spinning, for
+                  menus to move values by.
+    click         press and release, each one held for
+                  3 mS to count. if double clicks
+                  are on, this comes once the double
+                  click window has passed.
+    double_click  a second click inside the window.
+    long_press    the button was held past the long
+                  press time; sent while it is still
+                  held, and the release sends nothing.
 */
 
+enum {
+  rotary_turn = 1,
+  rotary_click = 2,
+  rotary_double_click = 3,
+  rotary_long_press = 4,
+};
+
+struct rotary_event_t {
+  uint32_t time_uS;   // low 32 bits of the timer
+  uint8_t type;       // rotary_turn etc.
+  int8_t step;        // turns: +1 or -1, see invertDirection()
+  int16_t amount;     // turns: step times the acceleration. clicks: mS held
+};
+
+const unsigned rotary_event_queue_size = 64;
+
+// a spin faster than this many detents per second moves each detent by
+// that many steps. the rate is averaged over the last few detents
+struct rotary_speed_step_t {
+  uint16_t detents_per_s;
+  int16_t steps;
+};
+const std::array<rotary_speed_step_t, 4> rotary_acceleration = {{
+  {5, 1}, {12, 2}, {25, 5}, {50, 10},
+}};
+
 class rotary_obj {
 private:
   unsigned _Apin;
   unsigned _Bpin;
   unsigned _Cpin;
   bool _invert;
-  unsigned _turnState;
-  unsigned _clickState;
-  int _turnBuffer;
-  unsigned long long int _lastClickTime;
-  std::deque<unsigned long long int> _clickQueue;
-  const unsigned stateMatrix[7][4] = {
+  uint8_t _turnState;
+  uint8_t _lastAB;
+  static constexpr uint8_t stateMatrix[7][4] = {
     {0,4,1,0},
     {2,0,1,0},{2,3,1,0},{2,3,0,8},
     {5,4,0,0},{5,4,6,0},{5,0,6,16}
   };
+  // acceleration
+  bool _accelerate;
+  int8_t _lastStep;
+  uint32_t _lastTurn;
+  uint32_t _interval;     // smoothed time between detents
+  // button: pressed / released once it has read the same for this long
+  static constexpr uint32_t click_settle_uS = 3000;
+  bool _clickRaw;         // the last read
+  uint32_t _clickRawSince;
+  bool _clickDown;
+  bool _longSent;
+  bool _clickPending;     // a click waiting to see if it becomes a double
+  uint32_t _pressedAt;
+  uint32_t _releasedAt;
+  uint16_t _pendingHeld;
+  uint32_t _longPress_uS;
+  uint32_t _doubleClick_uS;
+  unsigned _alarm;        // edge triggered: the timer alarm for on_alarm()
+  ringBuffer_obj<rotary_event_queue_size, rotary_event_t> _events;
+  std::atomic<unsigned> _eventsLost{0};  // written by the interrupts
+  std::atomic<unsigned> _missedSteps{0}; // written by the interrupts
+  void queue(uint32_t t, uint8_t type, int8_t step, int amount) {
+    rotary_event_t e;
+    e.time_uS = t;
+    e.type = type;
+    e.step = step;
+    e.amount = (amount > 32767 ? 32767 : amount);
+    if (!(_events.write(e))) {
+      _eventsLost.store(_eventsLost.load() + 1);
+    }
+  }
+  int16_t accelerated(uint32_t dt) {
+    _interval = (_interval ? (_interval + dt) / 2 : dt);
+    int16_t steps = 1;
+    for (auto& a : rotary_acceleration) {
+      if ((uint64_t)_interval * a.detents_per_s < 1'000'000) {
+        steps = a.steps;
+      }
+    }
+    return steps;
+  }
+  void turn(uint32_t t, int8_t step) {
+    uint32_t dt = t - _lastTurn;
+    int16_t amount = 1;
+    if (step != _lastStep || dt >= 250'000) {
+      _interval = 0;  // after a pause or a change of direction, start slow
+    } else if (_accelerate) {
+      amount = accelerated(dt);
+    }
+    _lastStep = step;
+    _lastTurn = t;
+    queue(t, rotary_turn, step, step * amount);
+  }
+  void click(uint32_t t, bool down) {
+    if (down) {
+      _pressedAt = t;
+      _longSent = false;
+      return;
+    }
+    if (_longSent) {
+      return;
+    }
+    uint16_t held = (t - _pressedAt) / 1000;
+    if (!(_doubleClick_uS)) {
+      queue(t, rotary_click, 0, held);
+    } else if (_clickPending) {
+      _clickPending = false;
+      queue(t, rotary_double_click, 0, held);
+    } else {
+      _clickPending = true;
+      _pendingHeld = held;
+      _releasedAt = t;
+    }
+  }
+  void quadrature(uint32_t t, unsigned A, unsigned B) {
+    uint8_t AB = (A << 1) | B;
+    if ((AB ^ _lastAB) == 0b11) {
+      _missedSteps.store(_missedSteps.load() + 1);
+    }
+    _lastAB = AB;
+    unsigned getRotation = (_invert ? ((A << 1) | B) : ((B << 1) | A));
+    _turnState = stateMatrix[_turnState & 0b00111][getRotation];
+    if (_turnState & 0b01000) {
+      turn(t, 1);
+    } else if (_turnState & 0b10000) {
+      turn(t, -1);
+    }
+  }
+  void button(uint32_t t, bool down) {
+    if (down != _clickRaw) {
+      _clickRaw = down;
+      _clickRawSince = t;
+    }
+    if (_clickRaw != _clickDown && (t - _clickRawSince >= click_settle_uS)) {
+      _clickDown = _clickRaw;
+      click(t, _clickDown);
+    }
+  }
+  void timeouts(uint32_t t) {
+    if (_clickDown && !(_longSent) && _longPress_uS && (t - _pressedAt >= _longPress_uS)) {
+      _longSent = true;
+      if (_clickPending) {
+        // the click before it was a click after all
+        _clickPending = false;
+        queue(_releasedAt, rotary_click, 0, _pendingHeld);
+      }
+      queue(t, rotary_long_press, 0, (t - _pressedAt) / 1000);
+    }
+    if (_clickPending && !(_clickDown) && (t - _releasedAt >= _doubleClick_uS)) {
+      _clickPending = false;
+      queue(_releasedAt, rotary_click, 0, _pendingHeld);
+    }
+  }
+  // edge triggered: set the alarm for whichever button timer ends first.
+  // with none running, the alarm is left to lapse
+  void arm_alarm(uint32_t t) {
+    uint32_t wait = ~0u;
+    auto sooner = [&](uint32_t since, uint32_t period) {
+      uint32_t left = since + period - t;
+      if (left > period) {
+        left = 0;   // already past
+      }
+      if (left < wait) {
+        wait = left;
+      }
+    };
+    if (_clickRaw != _clickDown) {
+      sooner(_clickRawSince, click_settle_uS);
+    }
+    if (_clickDown && !(_longSent) && _longPress_uS) {
+      sooner(_pressedAt, _longPress_uS);
+    }
+    if (_clickPending && !(_clickDown)) {
+      sooner(_releasedAt, _doubleClick_uS);
+    }
+    if (wait != ~0u) {
+      // an alarm set in the past would not fire until the timer wraps
+      timer_hw->alarm[_alarm] = t + (wait < 2 ? 2 : wait);
+    }
+  }
 public:
   void setup(unsigned Apin, unsigned Bpin, unsigned Cpin) {
     _Apin = Apin;
@@ -57,46 +264,74 @@ public:
     pinMode(_Cpin, INPUT_PULLUP);
     _invert = false;
     _turnState = 0;
-    _clickState = 0;
-    _turnBuffer = 0;
-    _lastClickTime = 0;
-    _clickQueue.clear();
+    _lastAB = 0b11;
+    _accelerate = true;
+    _lastStep = 0;
+    _lastTurn = 0;
+    _interval = 0;
+    _clickRaw = false;
+    _clickRawSince = 0;
+    _clickDown = false;
+    _longSent = false;
+    _clickPending = false;
+    _pressedAt = 0;
+    _releasedAt = 0;
+    _pendingHeld = 0;
+    _longPress_uS = 600'000;
+    _doubleClick_uS = 300'000;
+    _events.init();
   }
   void invertDirection(bool invert) {
     _invert = invert;
   }
+  // 0 turns either one off. double clicks delay single clicks by the window
+  void set_gestures(unsigned long_press_mS, unsigned double_click_mS, bool accelerate) {
+    _longPress_uS = long_press_mS * 1000;
+    _doubleClick_uS = double_click_mS * 1000;
+    _accelerate = accelerate;
+  }
+  // polled backend: the task manager calls this
   void poll() {
-    unsigned A = digitalRead(_Apin);
-    unsigned B = digitalRead(_Bpin);
-    unsigned getRotation = (_invert ? ((A << 1) | B) : ((B << 1) | A));
-    _turnState = stateMatrix[_turnState & 0b00111][getRotation];
-    _turnBuffer += (_turnState & 0b01000) >> 3;
-    _turnBuffer -= (_turnState & 0b10000) >> 4;
-    _clickState = (0b00011 & ((_clickState << 1) + (digitalRead(_Cpin) == LOW)));
-    unsigned long long int t = timer_hw->timerawh;
-    t = (t << 32) | timer_hw->timerawl;
-    switch (_clickState) { 
-      case 0b11:
-        _lastClickTime = t;
-        break;
-      case 0b10:
-        _clickQueue.push_back(t - _lastClickTime);
-        break;
-      default:
-        break;
-    }
-  }
-  int getTurnFromBuffer() {
-    int x = ((_turnBuffer > 0) ? 1 : -1) * (_turnBuffer != 0);
-    _turnBuffer -= x;
-    return x;
-  }
-  unsigned long long int getClickFromBuffer() {
-    unsigned long long int x = 0;
-    if (!(_clickQueue.empty())) {
-      x = _clickQueue.front();
-      _clickQueue.pop_front();
-    }
-    return x;
+    uint32_t t = timer_hw->timerawl;
+    quadrature(t, digitalRead(_Apin), digitalRead(_Bpin));
+    button(t, digitalRead(_Cpin) == LOW);
+    timeouts(t);
+  }
+  // edge triggered backend. call on the core that should take the
+  // interrupts; the two handlers just call on_edge() and on_alarm()
+  void begin_edge_triggered(unsigned alarm, void (*edge_irq)(), void (*alarm_irq)()) {
+    _alarm = alarm;
+    attachInterrupt(digitalPinToInterrupt(_Apin), edge_irq, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(_Bpin), edge_irq, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(_Cpin), edge_irq, CHANGE);
+    hw_set_bits(&timer_hw->inte, 1u << _alarm);
+    irq_set_exclusive_handler(_alarm, alarm_irq);
+    irq_set_enabled(_alarm, true);
+  }
+  void on_edge() {
+    uint32_t t = timer_hw->timerawl;
+    quadrature(t, digitalRead(_Apin), digitalRead(_Bpin));
+    button(t, digitalRead(_Cpin) == LOW);
+    timeouts(t);
+    arm_alarm(t);
+  }
+  void on_alarm() {
+    hw_clear_bits(&timer_hw->intr, 1u << _alarm);
+    uint32_t t = timer_hw->timerawl;
+    button(t, digitalRead(_Cpin) == LOW);
+    timeouts(t);
+    arm_alarm(t);
+  }
+  // core 0: next turn or click, oldest first
+  bool read_event(rotary_event_t& e) {
+    return _events.read(e);
+  }
+  // events that did not fit in the queue
+  unsigned get_lost_events() {
+    return _eventsLost.load();
+  }
+  // reads where both pins had changed since the last one
+  unsigned get_missed_steps() {
+    return _missedSteps.load();
   }
 };
@@ -1,90 +1,284 @@
 #pragma once
 #include "hardware/timer.h"
 #include "hardware/irq.h"       // library of code to let you interrupt code execution to run something of higher priority
-#include <functional>
+#include <array>
+#include <utility>
+#include <string>
 
 // task manager takes a list of repeat periods and callback functions
 // these should run in the background
 // set an alarm to run the "on_irq" boolean every "tick" microseconds.
-// load in the background functions you want using the "bind" language.
+//
+// the task list is fixed at compile time. each task_t names a period,
+// a global object and the member function to call on it, e.g.
+//   task_mgr_obj<16, task_t<32, audioOut, &audioOut_obj::poll>, ...>
+// so the interrupt calls the poll routines directly (and can inline them)
+// instead of going through std::function. periods that are not a whole
+// number of ticks are a compile error.
+//
+// each task keeps the absolute time it is next due. every interrupt
+// runs all the tasks that are due, either in the order they were added
+// (priority) or earliest deadline first. if the interrupt has used up
+// its time budget, the rest of the due tasks carry over to the next
+// interrupt, which is set one tick later.
+//
+// in tickless mode, the alarm is not set every tick. instead it is set
+// for whichever task is due soonest.
+//
+// if hardware_task_profiling is set, each execute() is timed and the
+// run time and start jitter (how long after its ideal deadline the task
+// started) are kept per task. if it is not set, none of this is compiled.
 
-static void on_irq();
+// execution profile of one task, in microseconds.
+// histograms are log2 buckets: 0, 1, 2-3, 4-7, 8-15, ...
+struct task_stats_obj {
+  static const unsigned buckets = 16;
+  unsigned count = 0;
+  unsigned min_uS = ~0u;
+  unsigned max_uS = 0;
+  unsigned long long int total_uS = 0;
+  unsigned max_jitter_uS = 0;
+  unsigned run_histogram[buckets] = {};
+  unsigned jitter_histogram[buckets] = {};
+  static unsigned bucket(unsigned uS) {
+    unsigned b = (uS ? 32 - __builtin_clz(uS) : 0);
+    return (b < buckets ? b : buckets - 1);
+  }
+  void add(unsigned run_uS, unsigned jitter_uS) {
+    ++count;
+    total_uS += run_uS;
+    if (run_uS < min_uS) {
+      min_uS = run_uS;
+    }
+    if (run_uS > max_uS) {
+      max_uS = run_uS;
+    }
+    if (jitter_uS > max_jitter_uS) {
+      max_jitter_uS = jitter_uS;
+    }
+    ++run_histogram[bucket(run_uS)];
+    ++jitter_histogram[bucket(jitter_uS)];
+  }
+  unsigned mean_uS() {
+    return (count ? total_uS / count : 0);
+  }
+  static std::string histogram_text(const unsigned (&h)[buckets]) {
+    std::string result;
+    for (unsigned b = 0; b < buckets; ++b) {
+      if (h[b]) {
+        result += " <" + std::to_string(1u << b) + ":" + std::to_string(h[b]);
+      }
+    }
+    return result;
+  }
+};
+
+// one entry in the task table
+template <unsigned arg_period_uS, auto& arg_object, auto arg_member>
+struct task_t {
+  static constexpr unsigned period = arg_period_uS;
+  static void execute() {
+    (arg_object.*arg_member)();
+  }
+};
 
+template <unsigned tick_uS, typename... tasks>
 class task_mgr_obj {
+  static_assert(tick_uS > 0, "tick must be at least 1 uS");
+  static_assert(((tasks::period >= tick_uS) && ...), "task period shorter than the hardware tick");
+  static_assert(((tasks::period % tick_uS == 0) && ...), "task period is not a whole number of hardware ticks");
   private:
+    static constexpr unsigned task_count = sizeof...(tasks);
     struct task_obj {
-      unsigned counter = 0;
       unsigned period;
-      std::function<void()> exec_on_trigger;
-      void set_period(unsigned arg_period) {
-        period = arg_period;
+      unsigned long long int next_due = 0;
+      // statistics, readable from the firmware
+      unsigned runs = 0;
+      unsigned late = 0;    // times it ran after its deadline
+      unsigned missed = 0;  // whole periods that were skipped
+      bool due(unsigned long long int now) {
+        return (next_due <= now);
       }
-      void set_trigger(std::function<void()> arg_func) {
-        exec_on_trigger = arg_func;
-      }
-      void increment(unsigned add_uS) {
-        counter += add_uS;
-      }
-      void execute() {
-        exec_on_trigger();
-      }
-      bool triggered() {
-        if (counter >= period) {
-          counter = counter % period;
-          return true;
-        }
-        return false;
+      // periods that were missed entirely are counted and dropped
+      // rather than run back-to-back
+      void schedule_after(unsigned long long int now) {
+        unsigned skipped = (now - next_due) / period;
+        ++runs;
+        late += (next_due < now);
+        missed += skipped;
+        next_due += period * (skipped + 1ull);
       }
     };
-    unsigned tick_uS = 0;
+    unsigned budget_uS = 0;
+    bool tickless = false;
+    bool by_deadline = false;
+    unsigned deferred = 0;   // interrupts that ran out of budget
     unsigned long long int next_trigger = 0;
     unsigned char alarm_ID = 0; // defined as a "byte" in the RP2040 hardware
+    std::array<task_stats_obj, (hardware_task_profiling ? task_count : 0)> stats;
+    // the interrupt handler has no arguments, so it finds the manager here
+    inline static task_mgr_obj* active = nullptr;
+    static void on_irq() {
+      active->dispatch();
+    }
+    // expands to one direct call per task, picked by index
+    template <size_t... I>
+    static void execute_by_index(unsigned n, std::index_sequence<I...>) {
+      ((n == I ? tasks::execute() : void()), ...);
+    }
+    static void execute(unsigned n) {
+      execute_by_index(n, std::index_sequence_for<tasks...>{});
+    }
+    // an alarm set in the past would not fire until the 32-bit timer wraps
+    const unsigned min_alarm_lead_uS = 2;
+    unsigned long long int read_timer() {
+      unsigned long long int t = timer_hw->timerawh;
+      return (t << 32) | timer_hw->timerawl;
+    }
+    void write_alarm() {
+      unsigned long long int earliest = read_timer() + min_alarm_lead_uS;
+      if (next_trigger < earliest) {
+        next_trigger = earliest;
+      }
+      timer_hw->alarm[alarm_ID] = next_trigger;
+    }
+    task_obj* next_task_due(unsigned long long int now) {
+      task_obj* result = nullptr;
+      for (auto& i : task_list) {
+        if (!(i.due(now))) {
+          continue;
+        }
+        if (!(by_deadline)) {
+          return &i;
+        }
+        if (!(result) || (i.next_due < result->next_due)) {
+          result = &i;
+        }
+      }
+      return result;
+    }
     public:
-      void init(unsigned arg_uS) {
-        tick_uS = arg_uS;
-        next_trigger = timer_hw->timerawh;
-        next_trigger = (next_trigger << 32) | timer_hw->timerawl;
+      // arg_budget_uS: time an interrupt may spend on tasks before the
+      // rest carry over. the first due task always runs. 0 = tick length.
+      void init(bool arg_tickless = false,
+        unsigned arg_budget_uS = 0, bool arg_by_deadline = false) {
+        tickless = arg_tickless;
+        budget_uS = (arg_budget_uS ? arg_budget_uS : tick_uS);
+        by_deadline = arg_by_deadline;
+        next_trigger = read_timer();
+        unsigned n = 0;
+        ((task_list[n++].period = tasks::period), ...);
       }
-      std::vector<task_obj> task_list;
+      std::array<task_obj, task_count> task_list;
       unsigned get_tick_uS() {
         return tick_uS;
       }
-      void add_task(unsigned arg_repeat_uS, std::function<void()> arg_on_trigger) {
-        task_obj new_task;
-        new_task.set_period(arg_repeat_uS);
-        new_task.set_trigger(arg_on_trigger);
-        task_list.emplace_back(new_task);
+      // time the current interrupt was scheduled for
+      unsigned long long int get_trigger_time() {
+        return next_trigger;
+      }
+      unsigned get_runs(unsigned task) {
+        return task_list[task].runs;
+      }
+      unsigned get_late(unsigned task) {
+        return task_list[task].late;
+      }
+      unsigned get_missed(unsigned task) {
+        return task_list[task].missed;
+      }
+      unsigned get_deferred() {
+        return deferred;
+      }
+      // one line per task, e.g. to send to the log on request
+      std::string report(unsigned task) {
+        auto& i = task_list[task];
+        std::string result = "task " + std::to_string(task)
+          + " period " + std::to_string(i.period)
+          + " runs " + std::to_string(i.runs)
+          + " late " + std::to_string(i.late)
+          + " missed " + std::to_string(i.missed);
+        if constexpr (hardware_task_profiling) {
+          auto& s = stats[task];
+          result += " | run uS min " + std::to_string(s.count ? s.min_uS : 0)
+            + " mean " + std::to_string(s.mean_uS())
+            + " max " + std::to_string(s.max_uS)
+            + task_stats_obj::histogram_text(s.run_histogram)
+            + " | jitter uS max " + std::to_string(s.max_jitter_uS)
+            + task_stats_obj::histogram_text(s.jitter_histogram);
+        }
+        return result;
+      }
+      void reset_stats() {
+        for (auto& i : task_list) {
+          i.runs = 0;
+          i.late = 0;
+          i.missed = 0;
+        }
+        for (auto& s : stats) {
+          s = task_stats_obj();
+        }
+        deferred = 0;
       }
       void set_timer() {
         next_trigger += tick_uS;
-        timer_hw->alarm[alarm_ID] = next_trigger;
+        write_alarm();
+      }
+      // tickless: aim the alarm at the earliest deadline in the task list.
+      // if something is already overdue, come back one tick from now.
+      void set_timer_to_next_due() {
+        unsigned long long int earliest = ~0ull;
+        for (auto& i : task_list) {
+          if (i.next_due < earliest) {
+            earliest = i.next_due;
+          }
+        }
+        if (earliest <= next_trigger) {
+          earliest = next_trigger + tick_uS;
+        }
+        next_trigger = earliest;
+        write_alarm();
       }
       void begin() {
         hw_set_bits(&timer_hw->inte, 1u << alarm_ID);  // initialize the timer
+        active = this;
         irq_set_exclusive_handler(alarm_ID, on_irq);     // function to run every interrupt
         irq_set_enabled(alarm_ID, true);               // ENGAGE!
-        set_timer();
+        for (auto& i : task_list) {
+          i.next_due = next_trigger + i.period;
+        }
+        if (tickless) {
+          set_timer_to_next_due();
+        } else {
+          set_timer();
+        }
       }
-      void repeat_timer() {
+      void dispatch() {
         hw_clear_bits(&timer_hw->intr, 1u << alarm_ID);
-        set_timer();
+        unsigned long long int now = next_trigger;
+        unsigned long long int start = read_timer();
+        bool first = true;
+        for (task_obj* t = next_task_due(now); t; t = next_task_due(now)) {
+          if (!(first) && (read_timer() - start >= budget_uS)) {
+            ++deferred;
+            break;
+          }
+          first = false;
+          unsigned n = t - task_list.data();
+          if constexpr (hardware_task_profiling) {
+            unsigned long long int ideal = t->next_due;
+            unsigned long long int began = read_timer();
+            t->schedule_after(now);
+            execute(n);
+            stats[n].add(read_timer() - began, (began > ideal ? began - ideal : 0));
+          } else {
+            t->schedule_after(now);
+            execute(n);
+          }
+        }
+        if (tickless) {
+          set_timer_to_next_due();
+        } else {
+          set_timer();
+        }
       }
 };
-
-// global definition, required to declare up front
-task_mgr_obj task_mgr;
-
-// global routine, required by RP2040 interrupt process
-static void on_irq() {
-  task_mgr.repeat_timer();
-  unsigned t = task_mgr.get_tick_uS();
-  for (auto& i : task_mgr.task_list) {
-    i.increment(t);
-  }
-  for (auto& i : task_mgr.task_list) {
-    if (i.triggered()) {
-        i.execute();
-        break;
-    }
-  }
-}
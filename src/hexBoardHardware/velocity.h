@@ -0,0 +1,181 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <cmath>
+
+// key velocity for analog keys, in integer math only.
+//
+// each key keeps its last `window` reads. a least-squares line through
+// them gives the velocity, and a least-squares parabola gives the
+// acceleration. the sums the fit needs are updated as each read comes
+// in (a few adds and multiplies, no loop over the window), and only
+// the numerators are handed on, so the divisions happen when someone
+// asks for the value, not on every read in the interrupt.
+//
+// the fit treats the reads as evenly spaced, and turns "per read" into
+// "per second" using the time between the oldest and newest read. the
+// scanner only pushes sweep reads (one per sweep of the grid, to within
+// a few uS), not the hot re-reads in between. the sweep itself takes
+// longer while keys are hot, so a read whose gap is off the window's
+// average by more than half again (or a third less) starts the window
+// again from the read before it, and the fit never spans the change.
+
+struct key_motion_t {
+  int32_t slope = 0;     // least-squares slope numerator, see slope_divisor()
+  int32_t curve = 0;     // quadratic term numerator, see curve_divisor()
+  uint32_t span_uS = 0;  // time from the oldest read in the window to the newest
+  uint8_t count = 0;     // reads in the window
+};
+
+template <unsigned window>
+class key_motion_obj {
+  static_assert(window >= 3 && window <= 32, "window must be 3 to 32 reads");
+  static_assert(window % 3 != 0, "quadratic weights need (window^2 - 1) / 3 to be whole");
+  private:
+    static constexpr int32_t n = window;
+    // the quadratic fit uses 4x the 2nd orthogonal polynomial on 0 .. n-1:
+    // q(x) = 4x^2 - 4(n-1)x + k, and the curvature is sum(q*y) / sum(q^2)
+    static constexpr int32_t k = (n - 1) * (n - 1) - (n * n - 1) / 3;
+    static constexpr int32_t sum_q2() {
+      int32_t s = 0;
+      for (int32_t x = 0; x < n; ++x) {
+        int32_t q = 4 * x * x - 4 * (n - 1) * x + k;
+        s += q * q;
+      }
+      return s;
+    }
+    std::array<int16_t, window> _y = {};
+    std::array<uint32_t, window> _t = {};
+    uint8_t _oldest = 0;
+    uint8_t _count = 0;
+    int32_t _sy = 0;      // sum of y
+    int32_t _sxy = 0;     // sum of x * y, x = 0 for the oldest read
+    int32_t _sxxy = 0;    // sum of x^2 * y
+    // reads close together can make either value bigger than an int32
+    // (e.g. noise on reads a few uS apart), so it stops at the end of the
+    // range instead of wrapping round to the other sign. -INT32_MAX, not
+    // INT32_MIN, so that the value can always be negated.
+    static int32_t saturate(int64_t v) {
+      return (v > INT32_MAX ? INT32_MAX : v < -INT32_MAX ? -INT32_MAX : (int32_t)v);
+    }
+  public:
+    void clear() {
+      _oldest = 0;
+      _count = 0;
+      _sy = 0;
+      _sxy = 0;
+      _sxxy = 0;
+    }
+    void push(int16_t y, uint32_t t) {
+      if (_count >= 2) {
+        uint32_t newest_t = _t[(_oldest + _count - 1) % n];
+        uint64_t gap = (uint32_t)(t - newest_t) * (uint64_t)(_count - 1);
+        uint64_t span = (uint32_t)(newest_t - _t[_oldest]);
+        if (2 * gap > 3 * span || 3 * gap < 2 * span) {
+          int16_t newest_y = newest();
+          clear();
+          push(newest_y, newest_t);
+        }
+      }
+      if (_count < n) {
+        int32_t x = _count;
+        _y[(_oldest + x) % n] = y;
+        _t[(_oldest + x) % n] = t;
+        _sy += y;
+        _sxy += x * y;
+        _sxxy += x * x * y;
+        ++_count;
+        return;
+      }
+      // drop the oldest read and shift every x down by one
+      int32_t y0 = _y[_oldest];
+      int32_t sy = _sy - y0;
+      _sxxy = _sxxy - 2 * _sxy + sy + (n - 1) * (n - 1) * y;
+      _sxy = _sxy - sy + (n - 1) * y;
+      _sy = sy + y;
+      _y[_oldest] = y;
+      _t[_oldest] = t;
+      _oldest = (_oldest + 1 < n ? _oldest + 1 : 0);
+    }
+    unsigned count() {
+      return _count;
+    }
+    // the last read pushed
+    int16_t newest() {
+      return (_count ? _y[(_oldest + _count - 1) % n] : 0);
+    }
+    key_motion_t motion() {
+      key_motion_t m;
+      m.count = _count;
+      if (_count < 2) {
+        return m;
+      }
+      int32_t c = _count;
+      int32_t sx = c * (c - 1) / 2;
+      m.slope = c * _sxy - sx * _sy;
+      m.span_uS = _t[(_oldest + c - 1) % n] - _t[_oldest];
+      if (c == n) {
+        m.curve = 4 * _sxxy - 4 * (n - 1) * _sxy + k * _sy;
+      }
+      return m;
+    }
+    // slope / slope_divisor(count) is the change per read
+    static int32_t slope_divisor(int32_t c) {
+      return c * c * (c * c - 1) / 12;
+    }
+    // 8 * curve / curve_divisor() is the second derivative per read^2
+    static constexpr int32_t curve_divisor() {
+      return sum_q2();
+    }
+    // resolution units per second. negative = the level is falling
+    static int32_t velocity_per_s(const key_motion_t& m) {
+      if (m.count < 2 || !(m.span_uS)) {
+        return 0;
+      }
+      return saturate((int64_t)m.slope * 1'000'000 * (m.count - 1)
+        / ((int64_t)slope_divisor(m.count) * m.span_uS));
+    }
+    // resolution units per second per second; 0 until the window is full
+    static int32_t acceleration_per_s2(const key_motion_t& m) {
+      if (m.count < n || !(m.span_uS)) {
+        return 0;
+      }
+      int64_t a = (int64_t)m.curve * 8 * (n - 1) * (n - 1) * 1'000'000 / m.span_uS;
+      if (a > INT64_MAX / 1'000'000 || a < -INT64_MAX / 1'000'000) {
+        return saturate(a);
+      }
+      return saturate(a * 1'000'000 / m.span_uS / curve_divisor());
+    }
+};
+
+// maps a key speed to a MIDI velocity, 1 to 127, through a lookup table.
+// the table covers speeds 0 .. full_speed in 128 steps; anything faster is 127.
+class velocity_curve_obj {
+  private:
+    std::array<uint8_t, 128> _table;
+    uint32_t _fullSpeed = 1;
+  public:
+    velocity_curve_obj() {
+      build(40'000, 100);
+    }
+    // shape_percent is an exponent in percent: 100 = linear,
+    // < 100 = loud sooner (soft touch), > 100 = harder to get loud
+    void build(uint32_t full_speed_per_s, unsigned shape_percent) {
+      _fullSpeed = (full_speed_per_s ? full_speed_per_s : 1);
+      for (unsigned i = 0; i < _table.size(); ++i) {
+        double x = i / 127.0;
+        _table[i] = 1 + (uint8_t)lround(126.0 * pow(x, shape_percent / 100.0));
+      }
+    }
+    // or supply your own
+    void load(const std::array<uint8_t, 128>& table) {
+      _table = table;
+    }
+    uint8_t midi_velocity(int32_t speed_per_s) {
+      uint32_t s = (speed_per_s < 0 ? -speed_per_s : speed_per_s);
+      if (s >= _fullSpeed) {
+        return _table[127];
+      }
+      return _table[(uint64_t)s * 127 / _fullSpeed];
+    }
+};
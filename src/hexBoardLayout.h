@@ -119,6 +119,8 @@ void apply_layout(Tunings::Tuning t, key_layout l) {
     hex_t d = k.coord - l.root_location;
     int m = t.keyboardMapping.middleNote 
       + (d.x * l.steps_per_2x + d.y * l.steps_per_2y) / 2;
+    k.tuningNote = m;
+    k.frequency = t.frequencyForMidiNote(m);
     k.scaleDegree = t.scalePositionForMidiNote(m);
     k.scaleEquave = t.equaveForMidiNote(m);
   }
@@ -179,6 +181,7 @@ void button_grid_setup() {
           eachRow.associated_pixel
         );
         hexBoard.coord_to_pixel[tempButton.coord] = tempButton.pixel; // add to the lookup map
+        hexBoard.switch_to_pixel[button_grid_t::switch_id(tempButton.atMux, tempButton.atCol)] = tempButton.pixel;
         hexBoard.button_data.emplace_back(tempButton);
         break;
     }
@@ -34,20 +34,20 @@ struct button_t : switch_t {
   unsigned pixel; // associated pixel
   unsigned index; // location within its array
 
-  int key_state; // down, up, press, release?
+  int key_state = button_off; // down, up, press, release?
   double key_velocity; // key press velocity in ticks per millisecond
   double key_pressure; // percentage pressure from 0 to 1
   unsigned long long int timePressed; // store time that press occurred
 
   unsigned zero = 0;
-  uint32_t LEDcodeBase;     // for now
-  uint32_t LEDcodeAnim;     // calculate it once and store value, to make LED playback snappier 
-  uint32_t LEDcodePlay;     // calculate it once and store value, to make LED playback snappier
-  uint32_t LEDcodeRest;     // calculate it once and store value, to make LED playback snappier
-  uint32_t LEDcodeOff;      // calculate it once and store value, to make LED playback snappier
-  uint32_t LEDcodeDim;      // calculate it once and store value, to make LED playback snappier
+  uint32_t LEDcodeBase = 0; // for now
+  pixel_level LEDcodeAnim; // calculate it once and store value, to make LED playback snappier 
+  pixel_level LEDcodePlay; // calculate it once and store value, to make LED playback snappier
+  pixel_level LEDcodeRest; // calculate it once and store value, to make LED playback snappier
+  pixel_level LEDcodeOff;  // calculate it once and store value, to make LED playback snappier
+  pixel_level LEDcodeDim;  // calculate it once and store value, to make LED playback snappier
                             // gradient rule, to be added
-  int animate; // store value to track animations
+  int animate = 0; // store value to track animations
   button_t(switch_t sw, hex_t x, unsigned p) : switch_t(sw.atMux, sw.atCol, sw.type), coord(x), pixel(p) {}
   button_t(unsigned m, unsigned c, unsigned t, hex_t x, unsigned p) : switch_t(m, c, t), coord(x), pixel(p) {}
 };
@@ -59,11 +59,12 @@ struct music_key_t : button_t {
   uint8_t midiBend;         // pitch bend for MPE purposes
   uint8_t midiCh;          // what channel (if not MPE mode)
   uint8_t midiTuningTable; // assigned MIDI note (if MTS mode)
+  int tuningNote;          // note number in the tuning table (see apply_layout)
   uint8_t midiChPlaying;          // what midi channel is there a note-on
   unsigned synthChPlaying;         // what synth channel is there a note-on
   int scaleEquave;
   unsigned scaleDegree;     // order in scale relative to equave
-  bool inScale; // for scale-lock purposes
+  bool inScale = true; // for scale-lock purposes
   music_key_t(button_t btn) : button_t(btn.atMux, btn.atCol, btn.type, btn.coord, btn.pixel) {}
 };
 
@@ -92,6 +93,10 @@ struct button_grid_t {
   std::map<hex_t, int> coord_to_pixel; // e.g. hex(0,-6) -> pixel 5
   std::map<int, bool> pixel_is_cmd;  // e.g. pixel 5 -> false, pixel 80 -> true
   std::map<int, unsigned> pixel_to_index; // e.g. pixel 5 -> 4 (key), pixel 80 -> 4 (cmd)
+  std::map<unsigned, int> switch_to_pixel; // e.g. switch_id(mux 3, col 2) -> pixel 22
+  static unsigned switch_id(unsigned atMux, unsigned atCol) {
+    return (atCol << 8) | atMux;
+  }
   music_key_t& key_at_pixel(const int pxl) {
     return keys[pixel_to_index.at(pxl)];
   }
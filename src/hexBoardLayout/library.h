@@ -19,7 +19,7 @@
 Tunings::Scale scale_12_edo  = Tunings::evenDivisionOfSpanByM(2, 12);
 Tunings::Scale scale_31_edo  = Tunings::evenDivisionOfSpanByM(2, 31);
 Tunings::Scale bohlen_pierce = Tunings::evenDivisionOfSpanByM(3, 13);
-Tunings::Scale carlos_alpha  = Tunings::evenDivisionOfCentsByM(701.684905896, 9, "Carlos Alpha");
+Tunings::Scale carlos_alpha  = Tunings::evenDivisionOfCentsByM(701.684905896, 9, ""); // last tone must be a pitch, not a name
 Tunings::Scale mos_3L_5s = Tunings::parseSCLData(R"SCL(!
 MOS_3L_5s_generator=757c
 8
@@ -0,0 +1,69 @@
+#pragma once
+#include "hexBoardHardware.h"
+#include "hexBoardSynth/synth.h"
+#include "hexBoardLayout/buttonGrid.h"
+#include "hexBoardLayout/tuningSystem.h"
+
+// number of notes the synth can play at once.
+// this is NOT the same as the MIDI polyphony limit, which is 15
+// (based on using channel 2 through 16 for polyphonic expression mode).
+const unsigned synth_polyphony = 16;
+// samples rendered per pass of loop1(). at 31.25 kHz, 32 samples is ~1 mS
+const unsigned synth_block_size = 32;
+synth_obj<synth_polyphony, synth_block_size> synth;
+
+// phase increment for every note in the tuning table, indexed like
+// Tunings::Tuning::ptable (i.e. tuning note + 256). built once per tuning
+// so that starting a note is a table lookup rather than float math.
+std::array<uint32_t, Tunings::Tuning::N> synth_note_increment = {};
+
+// run this if the tuning changes
+void synth_set_tuning(const Tunings::Tuning& t) {
+  for (int i = 0; i < Tunings::Tuning::N; ++i) {
+    synth_note_increment[i] = synth.increment_for(t.ptable[i] * Tunings::MIDI_0_FREQ);
+  }
+}
+
+uint32_t synth_increment_for_note(int tuningNote) {
+  int i = tuningNote + 256;
+  if (i < 0 || i >= Tunings::Tuning::N) {
+    return 0;
+  }
+  return synth_note_increment[i];
+}
+
+// global, call this on setup() i.e. the 1st core
+void synth_setup(const Tunings::Tuning& t) {
+  synth.setup(actual_audio_sample_rate_in_Hz);
+  synth_set_tuning(t);
+}
+
+// global, call this from loop1() i.e. the 2nd core.
+// render as many whole blocks as the audio buffer has room for.
+void synth_fill_audio_buffer() {
+  uint8_t block[synth_block_size];
+  while (audioOut.roomToWrite() >= synth_block_size) {
+    synth.render_block(block);
+    audioOut.write_block(block, synth_block_size);
+  }
+}
+
+// voice allocation, from core 0. synthChPlaying is 1-based; 0 = not playing
+std::array<bool, synth_polyphony> synth_voice_busy = {};
+void synth_note_on(music_key_t& k) {
+  for (unsigned v = 0; v < synth_polyphony; ++v) {
+    if (!(synth_voice_busy[v])) {
+      synth_voice_busy[v] = true;
+      k.synthChPlaying = v + 1;
+      synth.set_increment(v, synth_increment_for_note(k.tuningNote));
+      return;
+    }
+  }
+}
+void synth_note_off(music_key_t& k) {
+  if (k.synthChPlaying) {
+    synth.set_increment(k.synthChPlaying - 1, 0);
+    synth_voice_busy[k.synthChPlaying - 1] = false;
+    k.synthChPlaying = 0;
+  }
+}
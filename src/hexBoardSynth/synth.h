@@ -0,0 +1,284 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include "waveforms.h"
+#include "wavetable.h"
+
+// Effective Nov 15, 2024, the portion of the code related to setting the PWM pins
+// is moved to "hexBoardHardware/audio.h". This section is solely a synth generator,
+// and the resulting samples are written to the audio buffer so long as there is free space.
+//
+// samples are rendered a block at a time. everything that does not change
+// within a block (which voices are playing, their waveform shape, the mod
+// wheel, the volume and the polyphony attenuation) is worked out once at the
+// top of the block. then a tight loop runs over the block for each
+// playing voice, adding into a mix buffer.
+//
+// every waveform is played from band-limited tables (see wavetable.h),
+// so high notes do not alias. the tables for the current waveform are
+// built on core 0 when the waveform changes, into whichever of the two
+// table sets core 1 is not reading, and then handed over. each voice
+// picks its band when its pitch changes, so a sample is still one read.
+// the square wave is the difference of two band-limited saws, so the
+// mod wheel can still move its duty cycle without a rebuild.
+//
+// the synth runs on core 1 but notes are started and stopped from core 0.
+// the only thing the two cores share per voice is one 32-bit word (the
+// phase increment), so a note change is a single store and can never be
+// half-applied. each block picks up whatever increments are current.
+//
+// phases are 32-bit fixed point fractions of a cycle, so the pitch of a
+// voice is exact to about 0.00001 Hz. the top 8 bits index the waveform.
+// increment = frequency / sample rate * 2^32.
+
+enum {
+  WAVEFORM_SINE = 0,
+  WAVEFORM_STRINGS = 1,
+  WAVEFORM_CLARINET = 2,
+  WAVEFORM_HYBRID = 3,
+  WAVEFORM_SQUARE = 4,
+  WAVEFORM_SAW = 5,
+  WAVEFORM_TRIANGLE = 6,
+};
+
+/*
+  The hybrid synth sound blends between
+  square, saw, and triangle waveforms
+  at different frequencies. Said frequencies
+  are controlled via constants here.
+  (converted to phase increments at setup, so
+  the synth itself does no float math.)
+  Because the shape depends on the pitch, each
+  band of the hybrid tables is drawn with the
+  shape for the middle of that band.
+*/
+const float transition_square    =  220.0;
+const float transition_saw_low   =  440.0;
+const float transition_saw_high  =  880.0;
+const float transition_triangle  = 1760.0;
+
+template <unsigned polyphony, unsigned block_size>
+class synth_obj {
+  private:
+    /*
+      The oscillator bank holds every voice's state
+      side by side, one array per field, so that a
+      kernel walking the voices touches contiguous
+      memory.
+
+      Each oscillation frequency is stored in
+      the form of an increment value, which is
+      how much a counter would have to be increased
+      every sample, such that a counter overflows
+      from 0 to 2^32 - 1 back to zero at some frequency
+      per second.
+
+      band is which of the band-limited tables
+      the voice reads, which depends on the frequency.
+    */
+    struct oscillator_bank {
+      std::array<uint32_t, polyphony> increment = {};
+      std::array<uint32_t, polyphony> counter = {};
+      std::array<uint8_t, polyphony> band = {};
+      // voices with a nonzero increment, rebuilt every block
+      std::array<uint8_t, polyphony> active = {};
+      unsigned active_count = 0;
+    };
+    oscillator_bank bank;
+    wavetable_obj wavetable;
+    // core 1 plays from table[table_set]; core 0 builds into the other one.
+    // table_ack is the set core 1 last picked up.
+    std::array<wavetable_bands_t, 2> table;
+    std::array<unsigned, 2> table_waveform = {};
+    std::atomic<unsigned> table_set{0};
+    std::atomic<unsigned> table_ack{0};
+    std::array<std::atomic<uint32_t>, polyphony> target_increment;
+    std::array<int32_t, block_size> mix;
+    std::atomic<unsigned> mod_value{0};     // mod wheel, 0-127
+    std::atomic<unsigned> volume{127};      // velocity wheel, 0-127
+    std::atomic<bool> poly_mode{true};
+    float sample_rate = 1.0;
+    // transition frequencies as increments, set by setup()
+    uint32_t square_inc, saw_low_inc, saw_high_inc, triangle_inc;
+    // full volume in mono mode; equalized volume in poly.
+    // roughly 24 / sqrt(voices)
+    static constexpr uint8_t attenuation[17] = {64,24,17,14,12,11,10,9,8,8,8,7,7,7,6,6,6};
+    static_assert(polyphony <= 16, "attenuation table only covers 16 voices");
+    // the hybrid waveform at frequency f, given the top 8 bits of the phase
+    uint8_t hybrid(uint32_t f, uint8_t t) {
+      uint8_t B;
+      if (f < square_inc) {
+        B = 128;
+      } else if (f < saw_low_inc) {
+        B = 128 + (127ull * (f - square_inc)) / (saw_low_inc - square_inc);
+      } else if (f < saw_high_inc) {
+        B = 255;
+      } else if (f < triangle_inc) {
+        B = 127 + (128ull * (triangle_inc - f)) / (triangle_inc - saw_high_inc);
+      } else {
+        B = 127;
+      }
+      uint8_t A = ((f < saw_low_inc) ? 255 - B : 0);
+      uint8_t C = ((f < saw_low_inc) ? 255 : B);
+      if (t <= A) {
+        return 0;
+      } else if (t < B) {
+        return ((t - A) * ((B - A > 1) ? 65535 / (B - A - 1) : 65535)) >> 8;
+      } else if (t <= C) {
+        return 255;
+      }
+      return ((256 - t) * (65535 / (256 - C))) >> 8;
+    }
+    // the raw 256-sample shape of a waveform. the square wave is built
+    // from saws, see render_bank().
+    void draw(unsigned wave, unsigned band, uint8_t* out) {
+      for (unsigned i = 0; i < 256; ++i) {
+        const uint8_t t = i;
+        switch (wave) {
+          case WAVEFORM_SINE:     out[i] = sine[t];     break;
+          case WAVEFORM_STRINGS:  out[i] = strings[t];  break;
+          case WAVEFORM_CLARINET: out[i] = clarinet[t]; break;
+          case WAVEFORM_HYBRID:   out[i] = hybrid(wavetable.band_center(band), t); break;
+          case WAVEFORM_TRIANGLE: out[i] = ((t >> 7) ? 2 * (255 - t) : 2 * t); break;
+          default:                out[i] = t;           break;  // saw, square
+        }
+      }
+    }
+    void build_tables(unsigned set, unsigned wave) {
+      uint8_t raw[256];
+      for (unsigned b = 0; b < wavetable_band_count; ++b) {
+        if (b == 0 || wave == WAVEFORM_HYBRID) {
+          draw(wave, b, raw);
+        }
+        wavetable.band_limit(raw, wavetable.harmonics(b), table[set][b].data());
+      }
+      table_waveform[set] = wave;
+    }
+    // add every active voice into the mix. the square wave is
+    // saw(t) - saw(t + offset), which is high for the last
+    // offset/2^32 of the cycle, plus the offset to keep it positive.
+    template <bool square>
+    void render_bank(const wavetable_bands_t& tables, uint32_t offset) {
+      int32_t* out = mix.data();
+      for (unsigned n = 0; n < bank.active_count; ++n) {
+        const unsigned v = bank.active[n];
+        const uint32_t increment = bank.increment[v];
+        const int16_t* t = tables[bank.band[v]].data();
+        uint32_t counter = bank.counter[v];
+        for (unsigned i = 0; i < block_size; ++i) {
+          counter += increment;
+          if constexpr (square) {
+            out[i] += t[counter >> 24] - t[(counter + offset) >> 24] + (int32_t)(offset >> 24);
+          } else {
+            out[i] += t[counter >> 24];
+          }
+        }
+        bank.counter[v] = counter;
+      }
+    }
+    void set_bank_increment(unsigned v, uint32_t f) {
+      if (!(bank.increment[v])) {
+        bank.counter[v] = 0;
+      }
+      bank.increment[v] = f;
+      bank.band[v] = wavetable.band_for(f);
+    }
+  public:
+    // builds the tables for the default waveform, so call this before core 1 starts rendering
+    void setup(unsigned arg_sample_rate) {
+      sample_rate = arg_sample_rate;
+      square_inc   = increment_for(transition_square);
+      saw_low_inc  = increment_for(transition_saw_low);
+      saw_high_inc = increment_for(transition_saw_high);
+      triangle_inc = increment_for(transition_triangle);
+      for (auto& i : target_increment) {
+        i.store(0, std::memory_order_relaxed);
+      }
+      wavetable.setup();
+      build_tables(0, WAVEFORM_HYBRID);
+      table_set.store(0, std::memory_order_relaxed);
+      table_ack.store(0, std::memory_order_release);
+    }
+    // phase increment that plays frequency f. 0 if f is out of range.
+    // float math, so call this when tables are built, not per note.
+    uint32_t increment_for(double f) {
+      double inc = f / sample_rate * 4294967296.0 + 0.5;
+      return ((inc >= 1.0 && inc < 2147483648.0) ? (uint32_t)inc : 0);
+    }
+    static constexpr unsigned voice_count() {
+      return polyphony;
+    }
+    static constexpr unsigned samples_per_block() {
+      return block_size;
+    }
+    // bytes of band-limited tables held by the synth
+    static constexpr unsigned table_memory() {
+      return sizeof(std::array<wavetable_bands_t, 2>);
+    }
+    // the following are safe to call from core 0 at any time.
+    // set_waveform builds a table set, which takes a while, and returns
+    // false without doing anything if core 1 has not yet picked up the
+    // previous change (try again on a later loop).
+    bool set_waveform(unsigned arg_waveform) {
+      const unsigned current = table_set.load(std::memory_order_relaxed);
+      if (table_ack.load(std::memory_order_acquire) != current) {
+        return false;
+      }
+      if (table_waveform[current] == arg_waveform) {
+        return true;
+      }
+      const unsigned spare = 1 - current;
+      build_tables(spare, arg_waveform);
+      table_set.store(spare, std::memory_order_release);
+      return true;
+    }
+    void set_mod(unsigned arg_mod) {
+      mod_value.store(arg_mod, std::memory_order_relaxed);
+    }
+    void set_volume(unsigned arg_volume) {
+      volume.store(arg_volume, std::memory_order_relaxed);
+    }
+    void set_poly(bool arg_poly) {
+      poly_mode.store(arg_poly, std::memory_order_relaxed);
+    }
+    // increment 0 silences the voice
+    void set_increment(unsigned v, uint32_t inc) {
+      target_increment[v].store(inc, std::memory_order_relaxed);
+    }
+    void set_frequency(unsigned v, double f) {
+      set_increment(v, increment_for(f));
+    }
+    // render one block of 8-bit samples. call this from core 1.
+    void render_block(uint8_t* out) {
+      const unsigned set = table_set.load(std::memory_order_acquire);
+      table_ack.store(set, std::memory_order_release);
+      // duty cycle = 50% when mod = min; 6.25% when mod = max
+      const unsigned duty = 128 - (mod_value.load(std::memory_order_relaxed) >> 3) * 7;
+      mix.fill(0);
+      bank.active_count = 0;
+      for (unsigned v = 0; v < polyphony; ++v) {
+        uint32_t inc = target_increment[v].load(std::memory_order_relaxed);
+        if (inc != bank.increment[v]) {
+          set_bank_increment(v, inc);
+        }
+        if (bank.increment[v]) {
+          bank.active[bank.active_count++] = v;
+        }
+      }
+      if (table_waveform[set] == WAVEFORM_SQUARE) {
+        render_bank<true>(table[set], (255 - duty) << 24);
+      } else {
+        render_bank<false>(table[set], 0);
+      }
+      const unsigned voices = bank.active_count;
+      // [8bit]*atten[6bit] = [14bit], *vel[7bit] = [21bit], >> 13 = [8bit]
+      // band-limited tables ring slightly past 0-255, so clamp both ends
+      const int32_t gain = attenuation[poly_mode.load(std::memory_order_relaxed) * voices]
+        * volume.load(std::memory_order_relaxed);
+      for (unsigned i = 0; i < block_size; ++i) {
+        int32_t s = (mix[i] * gain) >> 13;
+        out[i] = (s < 0 ? 0 : s > 255 ? 255 : s);
+      }
+    }
+};
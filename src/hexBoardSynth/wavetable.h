@@ -0,0 +1,108 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+#include <cmath>
+
+/*
+  Band-limited wavetables.
+
+  A 256-sample waveform played back at a high pitch
+  contains harmonics above half the sample rate, which
+  fold back down as inharmonic noise (aliasing).
+  To avoid that, each waveform is stored as a set of
+  tables, one per "band" of pitches. Band 0 covers the
+  top quarter-octave below the Nyquist limit and keeps
+  only the fundamental; each band below it covers the
+  next quarter-octave down and keeps floor(2^(band/4))
+  harmonics, up to the full 128 a 256-sample table holds.
+
+  A voice looks up its band once, when its pitch changes,
+  so the per-sample cost is the same single table read as
+  an unfiltered table.
+
+  The tables are built in fixed point (a truncated DFT
+  and resynthesis using a Q15 sine table), so building a
+  full set is quick even without an FPU.
+*/
+
+const unsigned wavetable_bands_per_octave = 4;
+const unsigned wavetable_band_count = 7 * wavetable_bands_per_octave + 1;  // 1 .. 128 harmonics
+
+using wavetable_t = std::array<int16_t, 256>;
+using wavetable_bands_t = std::array<wavetable_t, wavetable_band_count>;
+
+class wavetable_obj {
+  private:
+    std::array<int16_t, 256> sin_q15;
+    // largest phase increment each band may be played at
+    std::array<uint32_t, wavetable_band_count> band_top;
+    int16_t cos_q15(unsigned i) {
+      return sin_q15[(i + 64) & 255];
+    }
+  public:
+    void setup() {
+      for (unsigned i = 0; i < 256; ++i) {
+        sin_q15[i] = (int16_t)lround(32767.0 * sin(6.283185307179586 * i / 256.0));
+      }
+      // phase increments are fractions of 2^32, so Nyquist is 2^31
+      for (unsigned b = 0; b < wavetable_band_count; ++b) {
+        band_top[b] = (uint32_t)(2147483648.0 / exp2((double)b / wavetable_bands_per_octave));
+      }
+    }
+    unsigned harmonics(unsigned band) {
+      return (unsigned)(exp2((double)band / wavetable_bands_per_octave) + 1e-9);
+    }
+    // geometric middle of the band, used when the shape depends on pitch
+    uint32_t band_center(unsigned band) {
+      return (band + 1 < wavetable_band_count
+        ? (uint32_t)sqrt((double)band_top[band] * band_top[band + 1])
+        : band_top[band] / 2);
+    }
+    // which table a voice with this phase increment should read
+    uint8_t band_for(uint32_t increment) {
+      uint8_t b = 0;
+      while ((b + 1u < wavetable_band_count) && (increment <= band_top[b + 1])) {
+        ++b;
+      }
+      return b;
+    }
+    // keep the first n harmonics of a 0-255 waveform.
+    // output stays centered on 128 but may overshoot 0-255 slightly.
+    void band_limit(const uint8_t* shape, unsigned n, int16_t* out) {
+      if (n > 128) {
+        n = 128;
+      }
+      int32_t dc = 0;
+      for (unsigned i = 0; i < 256; ++i) {
+        dc += shape[i];
+      }
+      dc /= 256;
+      // coefficients in 1/128ths of a sample step
+      int32_t re[129];
+      int32_t im[129];
+      for (unsigned h = 1; h <= n; ++h) {
+        int32_t a = 0;
+        int32_t b = 0;
+        for (unsigned i = 0; i < 256; ++i) {
+          int32_t x = shape[i] - 128;
+          a += x * cos_q15(h * i);
+          b += x * sin_q15[(h * i) & 255];
+        }
+        // 2/256 for the DFT, then Q15 -> Q7
+        re[h] = a >> 15;
+        im[h] = b >> 15;
+        if (h == 128) {
+          // the Nyquist bin is not doubled
+          re[h] /= 2;
+          im[h] /= 2;
+        }
+      }
+      for (unsigned i = 0; i < 256; ++i) {
+        int32_t y = 0;
+        for (unsigned h = 1; h <= n; ++h) {
+          y += (re[h] * cos_q15(h * i) + im[h] * sin_q15[(h * i) & 255]) >> 15;
+        }
+        out[i] = (int16_t)(dc + (y >> 7));
+      }
+    }
+};
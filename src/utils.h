@@ -19,6 +19,24 @@ using uint = unsigned int;
 // use an alias to make it easier to identify.
 using pixel_code = uint32_t;
 
+// a finer pixel color, for the LED output to dither between the
+// levels a pixel_code can hold: 8.8 fixed point on each channel,
+// i.e. 256 is one step of the LED.
+struct pixel_level {
+  uint16_t r = 0;
+  uint16_t g = 0;
+  uint16_t b = 0;
+  bool operator==(const pixel_level& o) const {
+    return r == o.r && g == o.g && b == o.b;
+  }
+  bool operator!=(const pixel_level& o) const {
+    return !(*this == o);
+  }
+};
+inline pixel_level to_pixel_level(pixel_code c) {
+  return {(uint16_t)((c >> 8) & 0xFF00), (uint16_t)(c & 0xFF00), (uint16_t)((c << 8) & 0xFF00)};
+}
+
 // time codes are unsigned 64-bit integers.
 // use an alias to make it easier to identify.
 using time_uS = uint64_t;